@@ -0,0 +1,297 @@
+// 基于完成通知的异步文件读写，供bin文件通过env->ioSubmit和env->ioWait使用
+// Linux上使用io_uring(直接调用系统调用，不依赖liburing)，不可用时以及其他平台上使用线程池执行
+#pragma once
+#include "constants.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#endif
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define HAVE_IO_URING
+#endif
+
+namespace _async_io_h{
+// 在当前线程中同步执行一个请求，返回传输的字节数，失败时返回-errno
+inline long long performIo(const IoRequest &request){
+#ifdef _WIN32
+    HANDLE file=(HANDLE)_get_osfhandle(request.fd);
+    if(file==INVALID_HANDLE_VALUE) return -EBADF;
+    OVERLAPPED overlapped;memset(&overlapped,0,sizeof(overlapped));
+    LARGE_INTEGER offset;offset.QuadPart=request.offset;
+    OVERLAPPED *position=nullptr; // offset<0时使用文件的当前位置
+    if(request.offset>=0){
+        overlapped.Offset=offset.LowPart;overlapped.OffsetHigh=offset.HighPart;
+        position=&overlapped;
+    }
+    DWORD transferred=0;BOOL ok;
+    if(request.opcode==IO_READ) ok=ReadFile(file,request.buf,(DWORD)request.size,&transferred,position);
+    else if(request.opcode==IO_WRITE) ok=WriteFile(file,request.buf,(DWORD)request.size,&transferred,position);
+    else return -EINVAL;
+    if(!ok) return GetLastError()==ERROR_HANDLE_EOF?0:-EIO;
+    return transferred;
+#else
+    ssize_t result;
+    if(request.opcode==IO_READ)
+        result=(request.offset<0)?read(request.fd,request.buf,request.size):
+                                  pread(request.fd,request.buf,request.size,request.offset);
+    else if(request.opcode==IO_WRITE)
+        result=(request.offset<0)?write(request.fd,request.buf,request.size):
+                                  pwrite(request.fd,request.buf,request.size,request.offset);
+    else return -EINVAL;
+    return result<0?-errno:result;
+#endif
+}
+
+// 所有线程共用的后备线程池，完成的请求交给提交者的回调
+class IoThreadPool {
+public:
+    using Callback=void (*)(void *owner,const IoCompletion &completion);
+    static IoThreadPool &instance() {
+        static IoThreadPool pool;
+        return pool;
+    }
+    void submit(const IoRequest &request,Callback callback,void *owner) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(workers.empty()) start();
+            jobs.push_back(Job{request,callback,owner});
+        }
+        cond.notify_one();
+    }
+    ~IoThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping=true;
+        }
+        cond.notify_all();
+        for(std::thread &worker:workers) worker.join();
+    }
+private:
+    struct Job{
+        IoRequest request;
+        Callback callback;
+        void *owner;
+    };
+    void start() {
+        // 阻塞的读写主要在等待设备，线程数可以多于CPU核心数
+        unsigned int count=std::max(4u,std::min(std::thread::hardware_concurrency(),16u));
+        for(unsigned int i=0;i<count;i++) workers.emplace_back([this]{run();});
+    }
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while(true){
+            cond.wait(lock,[this]{return stopping || !jobs.empty();});
+            if(jobs.empty()) return;
+            Job job=jobs.front();jobs.pop_front();
+            lock.unlock();
+            job.callback(job.owner,IoCompletion{job.request.user_data,performIo(job.request)});
+            lock.lock();
+        }
+    }
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::deque<Job> jobs;
+    std::vector<std::thread> workers;
+    bool stopping=false;
+};
+
+// 每个线程有各自的提交和完成队列，完成通知只返回给提交请求的线程
+class AsyncIO {
+public:
+    static inline bool use_io_uring=true; // 为false时总是使用线程池
+    static const unsigned int RING_ENTRIES=256;
+
+    static AsyncIO &current() {
+        static thread_local std::unique_ptr<AsyncIO> io(new AsyncIO);
+        return *io;
+    }
+    AsyncIO() {
+#ifdef HAVE_IO_URING
+        if(use_io_uring) setupRing();
+#endif
+    }
+    ~AsyncIO() {
+        // 线程池中可能还有本线程的请求，等待它们完成后才能释放
+        std::unique_lock<std::mutex> lock(mtx);
+        cond.wait(lock,[this]{return pool_pending==0;});
+        lock.unlock();
+#ifdef HAVE_IO_URING
+        if(ring_fd>=0){
+            munmap(sq_ring,sq_ring_size);
+            if(cq_ring!=sq_ring) munmap(cq_ring,cq_ring_size);
+            munmap(sqes,sqes_size);
+            close(ring_fd);
+        }
+#endif
+    }
+    AsyncIO(const AsyncIO &)=delete;
+    AsyncIO &operator=(const AsyncIO &)=delete;
+
+    // 提交count个请求，返回实际提交的个数，未完成的请求过多时可能少于count
+    int submit(const IoRequest *requests,int count) {
+        if(requests==nullptr || count<0) return INVALID_ARGUMENT;
+        for(int i=0;i<count;i++){
+            if(requests[i].opcode!=IO_READ && requests[i].opcode!=IO_WRITE) return INVALID_ARGUMENT;
+        }
+#ifdef HAVE_IO_URING
+        if(ring_fd>=0) return submitRing(requests,count);
+#endif
+        for(int i=0;i<count;i++){
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                pool_pending++;
+            }
+            IoThreadPool::instance().submit(requests[i],onPoolComplete,this);
+        }
+        return count;
+    }
+    // 取出最多max个完成通知，没有时最多等待timeout_ms毫秒(0表示不等待，负数表示一直等待)
+    // 返回取出的个数，没有未完成的请求时立即返回0
+    int wait(IoCompletion *completions,int max,int timeout_ms) {
+        if(completions==nullptr || max<=0) return INVALID_ARGUMENT;
+#ifdef HAVE_IO_URING
+        if(ring_fd>=0) return waitRing(completions,max,timeout_ms);
+#endif
+        std::unique_lock<std::mutex> lock(mtx);
+        auto ready=[this]{return !done.empty() || pool_pending==0;};
+        if(timeout_ms<0) cond.wait(lock,ready);
+        else if(timeout_ms>0) cond.wait_for(lock,std::chrono::milliseconds(timeout_ms),ready);
+        int count=0;
+        while(count<max && !done.empty()){
+            completions[count++]=done.front();done.pop_front();
+        }
+        return count;
+    }
+    bool usingRing() const {return ring_fd>=0;}
+private:
+    static void onPoolComplete(void *owner,const IoCompletion &completion) {
+        AsyncIO *io=(AsyncIO *)owner;
+        std::lock_guard<std::mutex> lock(io->mtx); // 解锁后io可能随线程结束被释放，须在锁内通知
+        io->done.push_back(completion);
+        io->pool_pending--; // 已完成但未取出的请求不再计入
+        io->cond.notify_all();
+    }
+#ifdef HAVE_IO_URING
+    void setupRing() {
+        io_uring_params params;
+        memset(&params,0,sizeof(params));
+        int fd=(int)syscall(__NR_io_uring_setup,RING_ENTRIES,&params);
+        if(fd<0) return; // 内核不支持或被禁用(如seccomp)，使用线程池
+        // IORING_OP_READ/WRITE和offset为-1的读写需要5.6以上的内核
+        if(!(params.features&IORING_FEAT_RW_CUR_POS)){close(fd);return;}
+        sq_ring_size=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+        cq_ring_size=params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+        bool single_mmap=params.features&IORING_FEAT_SINGLE_MMAP;
+        if(single_mmap) sq_ring_size=cq_ring_size=std::max(sq_ring_size,cq_ring_size);
+        sq_ring=mmap(nullptr,sq_ring_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+        if(sq_ring==MAP_FAILED){close(fd);return;}
+        cq_ring=single_mmap?sq_ring:mmap(nullptr,cq_ring_size,PROT_READ|PROT_WRITE,
+                                          MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_CQ_RING);
+        sqes_size=params.sq_entries*sizeof(io_uring_sqe);
+        sqes=(io_uring_sqe *)mmap(nullptr,sqes_size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,
+                                  fd,IORING_OFF_SQES);
+        if(cq_ring==MAP_FAILED || sqes==MAP_FAILED){
+            if(cq_ring!=MAP_FAILED && cq_ring!=sq_ring) munmap(cq_ring,cq_ring_size);
+            if(sqes!=MAP_FAILED) munmap(sqes,sqes_size);
+            munmap(sq_ring,sq_ring_size);close(fd);
+            return;
+        }
+        char *sq=(char *)sq_ring,*cq=(char *)cq_ring;
+        sq_head=(unsigned *)(sq+params.sq_off.head);sq_tail=(unsigned *)(sq+params.sq_off.tail);
+        sq_mask=*(unsigned *)(sq+params.sq_off.ring_mask);sq_array=(unsigned *)(sq+params.sq_off.array);
+        cq_head=(unsigned *)(cq+params.cq_off.head);cq_tail=(unsigned *)(cq+params.cq_off.tail);
+        cq_mask=*(unsigned *)(cq+params.cq_off.ring_mask);cqes=(io_uring_cqe *)(cq+params.cq_off.cqes);
+        sq_entries=params.sq_entries;cq_entries=params.cq_entries;
+        ring_fd=fd;
+    }
+    int enter(unsigned to_submit,unsigned min_complete,unsigned flags) {
+        int result;
+        do result=(int)syscall(__NR_io_uring_enter,ring_fd,to_submit,min_complete,flags,nullptr,0);
+        while(result<0 && errno==EINTR);
+        return result;
+    }
+    int submitRing(const IoRequest *requests,int count) {
+        int submitted=0;
+        while(submitted<count && ring_pending<cq_entries){ // 未取出的完成通知不超过完成队列的大小
+            unsigned tail=*sq_tail,head=__atomic_load_n(sq_head,__ATOMIC_ACQUIRE);
+            unsigned batch=0;
+            while(submitted+(int)batch<count && tail-head<sq_entries && ring_pending+batch<cq_entries){
+                const IoRequest &request=requests[submitted+batch];
+                unsigned index=tail&sq_mask;
+                io_uring_sqe *sqe=&sqes[index];
+                memset(sqe,0,sizeof(*sqe));
+                sqe->opcode=(request.opcode==IO_WRITE)?IORING_OP_WRITE:IORING_OP_READ;
+                sqe->fd=request.fd;
+                sqe->addr=(unsigned long long)(size_t)request.buf;
+                sqe->len=(unsigned)request.size;
+                sqe->off=(unsigned long long)request.offset; // -1表示使用文件的当前位置
+                sqe->user_data=(unsigned long long)(size_t)request.user_data;
+                sq_array[index]=index;
+                tail++;batch++;
+            }
+            if(batch==0) break;
+            __atomic_store_n(sq_tail,tail,__ATOMIC_RELEASE);
+            int result=enter(batch,0,0); // 一次系统调用提交整批请求
+            if(result<0) break;
+            ring_pending+=result;submitted+=result;
+            if((unsigned)result<batch) break;
+        }
+        return submitted;
+    }
+    int waitRing(IoCompletion *completions,int max,int timeout_ms) {
+        int count=reapRing(completions,max);
+        if(count>0 || timeout_ms==0 || ring_pending==0) return count;
+        if(timeout_ms<0) enter(0,1,IORING_ENTER_GETEVENTS);
+        else{ // 有完成通知时io_uring的文件描述符可读
+            struct pollfd pfd{ring_fd,POLLIN,0};
+            poll(&pfd,1,timeout_ms);
+        }
+        return reapRing(completions,max);
+    }
+    int reapRing(IoCompletion *completions,int max) {
+        unsigned head=*cq_head,tail=__atomic_load_n(cq_tail,__ATOMIC_ACQUIRE);
+        int count=0;
+        while(head!=tail && count<max){
+            const io_uring_cqe &cqe=cqes[head&cq_mask];
+            completions[count++]=IoCompletion{(void *)(size_t)cqe.user_data,(long long)cqe.res};
+            head++;
+        }
+        __atomic_store_n(cq_head,head,__ATOMIC_RELEASE);
+        ring_pending-=count;
+        return count;
+    }
+
+    void *sq_ring=nullptr,*cq_ring=nullptr;
+    size_t sq_ring_size=0,cq_ring_size=0,sqes_size=0;
+    io_uring_sqe *sqes=nullptr;
+    io_uring_cqe *cqes=nullptr;
+    unsigned *sq_head,*sq_tail,*sq_array,*cq_head,*cq_tail;
+    unsigned sq_mask=0,cq_mask=0,sq_entries=0,cq_entries=0;
+    unsigned ring_pending=0; // 已提交但未取出完成通知的请求数
+#endif
+    int ring_fd=-1;
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::deque<IoCompletion> done; // 线程池完成的请求
+    size_t pool_pending=0;
+};
+}
+using _async_io_h::performIo;
+using _async_io_h::IoThreadPool;
+using _async_io_h::AsyncIO;
@@ -0,0 +1,226 @@
+// bin_runtime热路径的基准测试，每项结果输出一行JSON，便于记录并和之前的结果比较
+// 用法: bench_runtime [--filter=<子串>] [--repeat=<n>] [--runtime=<bin_runtime的路径>]
+// 直接包含bin_runtime.cpp以调用其中的函数，bin_runtime的main改名为bin_runtime_main
+#define main bin_runtime_main
+#include "bin_runtime.cpp"
+#undef main
+#include <chrono>
+#include <functional>
+
+const char *BENCH_DIR="bench_tmp"; // 存放生成的模块文件
+#ifdef _WIN32
+const char *LIBC_NAME="msvcrt.dll";
+const char *NULL_DEVICE="NUL";
+const char *RUNTIME_NAME="bin_runtime.exe";
+#elif defined(__APPLE__)
+const char *LIBC_NAME="libc.dylib";
+const char *NULL_DEVICE="/dev/null";
+const char *RUNTIME_NAME="bin_runtime";
+#else
+const char *LIBC_NAME="libc.so.6";
+const char *NULL_DEVICE="/dev/null";
+const char *RUNTIME_NAME="bin_runtime";
+#endif
+
+string bench_filter; // 只运行名称包含该子串的测试
+int bench_repeat=5; // 每项测试重复的次数，输出最小值和中位数
+volatile size_t bench_sink; // 防止被测的调用被优化掉
+
+void runBench(const char *name,size_t iterations,const function<void(size_t)> &op,
+              const function<void(int)> &setup=nullptr){
+    // 运行bench_repeat次，每次调用op(0..iterations-1)，setup在每次计时之前调用
+    if(!bench_filter.empty() && strstr(name,bench_filter.c_str())==nullptr) return;
+    vector<double> results;
+    for(int run=0;run<bench_repeat;run++){
+        if(setup) setup(run);
+        auto start=chrono::steady_clock::now();
+        for(size_t i=0;i<iterations;i++) op(i);
+        auto end=chrono::steady_clock::now();
+        results.push_back(chrono::duration<double,nano>(end-start).count()/iterations);
+    }
+    sort(results.begin(),results.end());
+    printf("{\"name\":\"%s\",\"iterations\":%zu,\"repeat\":%d,"
+           "\"min_ns_per_op\":%.2f,\"median_ns_per_op\":%.2f}\n",
+           name,iterations,bench_repeat,results.front(),results[results.size()/2]);
+    fflush(stdout);
+}
+string writeBenchModule(const string &name,size_t id){
+    // 生成内容互不相同的小模块(xor eax,eax; ret和编号)，返回import的参数
+    string path=string(BENCH_DIR)+(char)pathsep+name+FILEEXT;
+    FILE *file=fopen(path.c_str(),"wb");
+    if(file==nullptr) throw runtime_error("Cannot create "+path);
+    unsigned char code[]={0x31,0xc0,0xc3};
+    fwrite(code,1,sizeof(code),file);
+    fwrite(&id,sizeof(id),1,file);
+    fclose(file);
+    return path;
+}
+bool fileExists(const char *path){
+    FILE *file=fopen(path,"rb");
+    if(file==nullptr) return false;
+    fclose(file);
+    return true;
+}
+
+__attribute__((noinline)) int benchAbs(int value) noexcept {return value<0?-value:value;}
+RuntimeEnv *volatile bench_env; // 每次调用都重新读取，和bin文件中的env->xxx(...)相同
+
+void benchImport(){
+    const size_t COLD=200,WARM=100000;
+    vector<vector<string>> cold_paths(bench_repeat);
+    size_t id=0;
+    for(int run=0;run<bench_repeat;run++){
+        for(size_t i=0;i<COLD;i++)
+            cold_paths[run].push_back(writeBenchModule("cold_"+to_string(run)+"_"+to_string(i),id++));
+    }
+    vector<string> *paths=nullptr;
+    runBench("import_cold",COLD,[&](size_t i){
+        bench_sink=import((*paths)[i].c_str());
+    },[&](int run){paths=&cold_paths[run];});
+
+    string warm=writeBenchModule("warm",id++);
+    import(warm.c_str());
+    runBench("import_warm",WARM,[&](size_t){
+        bench_sink=import(warm.c_str());
+    });
+    runBench("get_func",WARM,[&](size_t){
+        bench_sink=(size_t)getFunc("warm");
+    });
+    int handle=getModuleHandle("warm");
+    runBench("get_func_by_id",WARM,[&](size_t){
+        bench_sink=(size_t)getFuncById(handle);
+    });
+    for(const vector<string> &run_paths:cold_paths) // 已导入的模块在内存中，文件可以删除
+        for(const string &path:run_paths) remove(path.c_str());
+    remove(warm.c_str());
+}
+void benchLibrary(){
+    if(getLibraryFunc(LIBC_NAME,"strlen")==nullptr){
+        fprintf(stderr,"Skipping get_library_func: cannot load %s\n",LIBC_NAME);
+        return;
+    }
+    runBench("get_library_func",100000,[&](size_t){
+        bench_sink=(size_t)getLibraryFunc(LIBC_NAME,"strlen");
+    });
+}
+void benchCalls(){
+    // 通过RuntimeEnv间接调用和直接调用同一个函数
+    const size_t CALLS=10000000;
+    RuntimeEnv *env=new RuntimeEnv(*runtime_env);
+    env->abs=benchAbs;
+    bench_env=env;
+    runBench("env_indirect_call",CALLS,[&](size_t i){
+        bench_sink=bench_env->abs((int)i);
+    });
+    runBench("direct_call",CALLS,[&](size_t i){
+        bench_sink=benchAbs((int)i);
+    });
+    delete env;
+}
+void benchExecMemory(){
+    runBench("exec_alloc_free",10000,[&](size_t){
+        void *ptr=allocExecMemory(4096);
+        bench_sink=(size_t)ptr;
+        freeExecMemory(ptr,4096);
+    });
+    ExecArena arena;
+    runBench("arena_alloc",100000,[&](size_t){
+        bench_sink=(size_t)arena.alloc(256);
+    },[&](int){arena.releaseAll();});
+}
+void benchHeap(){
+    // 小对象经过env->malloc和经过env->arenaAlloc分配
+    const size_t ALLOCS=100000;
+    vector<void *> ptrs(ALLOCS);
+    runBench("env_malloc",ALLOCS,[&](size_t i){
+        ptrs[i]=runtime_env->malloc(48);
+        bench_sink=(size_t)ptrs[i];
+    },[&](int run){
+        if(run==0) return;
+        for(void *ptr:ptrs) runtime_env->free(ptr);
+    });
+    for(void *ptr:ptrs) runtime_env->free(ptr);
+    void *arena=runtime_env->arenaCreate(0,0);
+    runBench("heap_arena_alloc",ALLOCS,[&](size_t){
+        bench_sink=(size_t)runtime_env->arenaAlloc(arena,48);
+    },[&](int){runtime_env->arenaReset(arena);});
+    runtime_env->arenaDestroy(arena);
+}
+void benchScan(){
+    // 在4MB的随机数据中查找不存在的模式，每次操作为扫描整个缓冲区
+    const size_t SIZE=4<<20,SCANS=20;
+    vector<unsigned char> data(SIZE);
+    unsigned int seed=12345;
+    for(unsigned char &byte:data){
+        seed=seed*1103515245+12345;
+        byte=(unsigned char)(seed>>16);
+    }
+    const char *magic=IMPORT_SLOT_MAGIC;size_t magic_len=strlen(magic);
+    runBench("find_bytes_4mb",SCANS,[&](size_t){
+        bench_sink=(size_t)findBytes(data.data(),SIZE,magic,magic_len);
+    });
+    runBench("find_bytes_scalar_4mb",SCANS,[&](size_t){
+        bench_sink=(size_t)byte_scanner::findBytesScalar(data.data(),SIZE-magic_len+1,
+                                                        (const unsigned char *)magic,magic_len);
+    });
+    MultiPatternScanner scanner;
+    scanner.add(magic,magic_len,0);
+    scanner.add(BUNDLE_MAGIC,sizeof(BUNDLE_MAGIC),1);
+    scanner.add("\x0f\x0b\x0f\x0b",4,2); // ud2; ud2
+    scanner.build();
+    runBench("multi_pattern_scan_4mb",SCANS,[&](size_t){
+        bench_sink=scanner.scan(data.data(),SIZE,[](int,size_t){return true;});
+    });
+}
+void benchWorkloads(const string &runtime_path){
+    // fibs.bin和main_bin.bin由bin_dk生成，不存在时跳过
+    if(fileExists("fibs.bin") && import("fibs")==IMPORT_SUCCESS){
+        using FibsFunc=unsigned long (*)(unsigned long);
+        FibsFunc fibs=(FibsFunc)getFunc("fibs");
+        runBench("fibs_call",1000000,[&](size_t i){
+            bench_sink=fibs(90+(i&7));
+        });
+    } else fprintf(stderr,"Skipping fibs_call: fibs.bin not found\n");
+    if(fileExists("main_bin.bin") && fileExists(runtime_path.c_str())){
+        string command=runtime_path+" main_bin.bin >"+NULL_DEVICE;
+        runBench("run_main_bin",20,[&](size_t){
+            FILE *pipe=popen(command.c_str(),"w");
+            if(pipe==nullptr) throw runtime_error("Cannot run "+command);
+            fputs("30\n",pipe);
+            bench_sink=pclose(pipe);
+        });
+    } else fprintf(stderr,"Skipping run_main_bin: main_bin.bin or %s not found\n",runtime_path.c_str());
+}
+
+int main(int argc,const char *argv[]){
+    string runtime_path=string(".")+(char)pathsep+RUNTIME_NAME;
+    for(int i=1;i<argc;i++){
+        if(strncmp(argv[i],"--filter=",9)==0) bench_filter=argv[i]+9;
+        else if(strncmp(argv[i],"--repeat=",9)==0) bench_repeat=max(1,atoi(argv[i]+9));
+        else if(strncmp(argv[i],"--runtime=",10)==0) runtime_path=argv[i]+10;
+        else{
+            fprintf(stderr,"Usage: %s [--filter=<substring>] [--repeat=<n>] [--runtime=<path>]\n",argv[0]);
+            return 1;
+        }
+    }
+    runtime_env=new RuntimeEnv();
+    initRuntimeEnv(runtime_env);
+#ifdef _WIN32
+    CreateDirectoryA(BENCH_DIR,NULL);
+#else
+    mkdir(BENCH_DIR,0755);
+#endif
+    try{
+        benchImport();
+        benchLibrary();
+        benchCalls();
+        benchExecMemory();
+        benchHeap();
+        benchScan();
+        benchWorkloads(runtime_path);
+    }catch(exception &err){
+        fprintf(stderr,"%s\n",err.what());
+        return 1;
+    }
+    return 0;
+}
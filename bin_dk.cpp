@@ -1,7 +1,7 @@
 #include "bin_dk.h"
 
 using ul=unsigned long;
-ul fibs(ul num){
+BIN_EXPORT ul fibs(ul num){
 	ul i,a=0,b=1,c=0;
 	for (i=0;i<num;i++){
 		c=a;
@@ -10,7 +10,7 @@ ul fibs(ul num){
 	}
 	return a;
 }
-int main_bin(int argc,const char *argv[],RuntimeEnv *env){ // 真正的.bin文件的入口函数
+BIN_EXPORT int main_bin(int argc,const char *argv[],RuntimeEnv *env){ // 真正的.bin文件的入口函数
     char func[]="fibs",tip[]="Enter a number: ",
          fmt[]="%lu",print_fmt[]="Result: %lu\n",
          errmsg[]="Error importing %s.\n";
@@ -26,7 +26,7 @@ int main_bin(int argc,const char *argv[],RuntimeEnv *env){ // 真正的.bin文
     env->printf(print_fmt,result);
     return 0;
 }
-int debug(int argc,const char *argv[],RuntimeEnv *env){
+BIN_EXPORT int debug(int argc,const char *argv[],RuntimeEnv *env){
     // 测试bin文件的运行环境
     char dllname[]="msvcrt.dll",funcname[]="printf",
          msg[]="Arguments: \n",fmt[]="%s ",fmt_end[]="%s\n\n";
@@ -40,9 +40,11 @@ int debug(int argc,const char *argv[],RuntimeEnv *env){
     env->stackTrace();
     return 0;
 }
-int main() { // 仅用于导出机器码到.bin文件
-    DUMP_BIN_MINSIZE(fibs,80);
-    DUMP_BIN_MINSIZE(main_bin,512);
-    DUMP_BIN_MINSIZE(debug,512);
+int main(int argc,const char *argv[]) { // 仅用于导出机器码到.bin文件
+    if(argc>1) return exportFromSymbols(argc,argv); // 按符号表批量导出，如bin_dk --all
+    DUMP_BIN(fibs);
+    DUMP_BIN(main_bin);
+    DUMP_DEPS(main_bin,"fibs");
+    DUMP_BIN(debug);
     return 0;
 }
\ No newline at end of file
@@ -1,12 +1,21 @@
 #include "runtime_env.h"
 #include "utils.h"
 #include "constants.h"
+#include "bundle.h"
+#include "x86_decoder.h"
+#include "symbol_table.h"
 #include <cstdio>
 #include <cstring>
 #include <climits>
 #include <cerrno>
 #include <stdexcept>
 #include <algorithm>
+#include <initializer_list>
+#include <string>
+#include <unordered_set>
+#include <cxxabi.h>
+#include <cctype>
+#include <cstdlib>
 using namespace std;
 
 using uchar=unsigned char;
@@ -16,7 +25,29 @@ using ushort=unsigned short;
 const uchar RET=0xc3;
 const uchar NOP=0x90;
 
+size_t findRetBeforePadding(void *funcptr,size_t maxsize){
+    // 查找之后是对齐填充(int3、nop或多字节nop)的第一个RET，函数中间的RET之后一般不是填充
+    static MultiPatternScanner scanner=[]{
+        MultiPatternScanner scanner;
+        const uchar patterns[][3]={{RET,0xcc},{RET,NOP},{RET,0x66,0x90},{RET,0x66,0x0f},{RET,0x0f,0x1f}};
+        const size_t lengths[]={2,2,3,3,3};
+        for(int i=0;i<5;i++) scanner.add(patterns[i],lengths[i],i);
+        scanner.build();
+        return scanner;
+    }();
+    size_t found=SIZE_MAX;
+    scanner.scan(funcptr,maxsize,[&](int,size_t offset){
+        found=offset;
+        return false;
+    });
+    return found;
+}
 size_t getFuncCodeSize(void *funcptr,size_t maxsize=SIZE_MAX>>1){
+    // 沿所有分支解码指令，得到函数的实际大小，无法解码时退回查找RET
+    size_t size=findFunctionExtent(funcptr,maxsize);
+    if(size!=0) return size;
+    size_t ret=findRetBeforePadding(funcptr,maxsize);
+    if(ret!=SIZE_MAX) return ret+1;
     uchar *delta=(uchar *)memchr(funcptr,RET,maxsize);
     if(delta==nullptr) return SIZE_MAX;
     return (delta-(uchar *)funcptr)+1;
@@ -43,6 +74,13 @@ void dumpFunctoFile(void *funcptr,const char *filename,
     size_t size=max(minsize,getFuncCodeSize(funcptr,maxsize));
     dumpMemory(funcptr,filename,size);
 }
+void dumpDepsFile(const char *filename,initializer_list<const char *> deps){
+    // 生成模块的依赖声明文件，bin_runtime会在调用入口函数之前预先加载这些模块
+    FILE *file=fopen(filename,"w");
+    if(!file) throw runtime_error(strerror(errno));
+    for(const char *dep:deps) fprintf(file,"%s\n",dep);
+    fclose(file);
+}
 
 #define DUMP_BIN(func){\
     dumpFunctoFile((void *)(func),#func".bin");\
@@ -53,3 +91,104 @@ void dumpFunctoFile(void *funcptr,const char *filename,
     printf("Successfully generated "#func".bin.\n");\
 }
 #define DUMP_BIN_MINSIZE(func,minsize) DUMP_BIN_SIZE(func,(minsize),SIZE_MAX>>1)
+#define DUMP_DEPS(func,...){\
+    dumpDepsFile(#func".deps",{__VA_ARGS__});\
+    printf("Successfully generated "#func".deps.\n");\
+}
+
+// 将多个函数导出到同一个.bnd文件中
+#define BUNDLE_ADD_SIZE(bundle,func,minsize,maxsize){\
+    (bundle).add(#func,(void *)(func),\
+                 max((size_t)(minsize),getFuncCodeSize((void *)(func),(maxsize))));\
+}
+#define BUNDLE_ADD(bundle,func) BUNDLE_ADD_SIZE(bundle,func,0,SIZE_MAX>>1)
+#define BUNDLE_ADD_MINSIZE(bundle,func,minsize) BUNDLE_ADD_SIZE(bundle,func,(minsize),SIZE_MAX>>1)
+#define DUMP_BUNDLE(bundle){\
+    (bundle).save();\
+    printf("Successfully generated %s.\n",(bundle).filename.c_str());\
+}
+
+// 标记需要导出的函数，bin_dk --all会从符号表中找出所有标记的函数并导出
+#define BIN_EXPORT_SECTION ".binexp"
+#define BIN_EXPORT __attribute__((section(BIN_EXPORT_SECTION),used,noinline))
+
+string symbolToModuleName(const char *symbol){
+    // 由符号名得到模块名，C++函数去掉名称修饰和参数列表，不是普通标识符时返回空字符串
+#if defined(_WIN32) && !defined(_WIN64)
+    if(*symbol=='_') symbol++; // 32位Windows的符号名以'_'开头
+#endif
+    // 编译器生成的片段(如fibs.part.0、func.cold)去掉名称修饰后和原函数同名，须在去掉参数列表之前排除
+    if(strchr(symbol,'.')!=nullptr) return "";
+    string name=symbol;
+    int status;char *demangled=abi::__cxa_demangle(symbol,nullptr,nullptr,&status);
+    if(demangled!=nullptr){
+        name=demangled;free(demangled);
+        if(name.find(" [clone")!=string::npos) return "";
+        size_t paren=name.find('(');
+        if(paren!=string::npos) name.resize(paren);
+    }
+    if(name.empty() || isdigit((uchar)name[0])) return "";
+    for(char c:name)
+        if(!isalnum((uchar)c) && c!='_') return "";
+    return name;
+}
+int exportFromSymbols(int argc,const char *argv[]){
+    // bin_dk的批量导出模式，读取bin_dk自身的符号表，一次导出所有匹配的函数，大小由符号表得到
+    bool marked_only=false,list_only=false;
+    const char *pattern=nullptr,*bundle_name=nullptr;
+    for(int i=1;i<argc;i++){
+        if(strcmp(argv[i],"--all")==0) marked_only=true;
+        else if(strncmp(argv[i],"--match=",8)==0) pattern=argv[i]+8;
+        else if(strncmp(argv[i],"--bundle=",9)==0) bundle_name=argv[i]+9;
+        else if(strcmp(argv[i],"--list")==0) list_only=true;
+        else {
+            printf("Unknown option: %s\n",argv[i]);
+            printf("Usage: bin_dk [--all] [--match=<pattern>] [--bundle=<name>] [--list]\n");
+            return 1;
+        }
+    }
+    if(!marked_only && pattern==nullptr) marked_only=true;
+
+    vector<FuncSymbol> symbols=readFunctionSymbols();
+    BundleWriter bundle(bundle_name?bundle_name:"");
+    unordered_set<string> exported;size_t count=0;
+    for(const FuncSymbol &sym:symbols){
+        if(marked_only && sym.section!=BIN_EXPORT_SECTION) continue;
+        string name=symbolToModuleName(sym.name.c_str());
+        if(name.empty() || (pattern!=nullptr && !matchPattern(pattern,name.c_str())))
+            continue;
+        if(!exported.insert(name).second){ // 重载的函数只导出第一个
+            fprintf(stderr,"Warning: duplicate function %s (%s) skipped.\n",
+                    name.c_str(),sym.name.c_str());
+            continue;
+        }
+        // PE文件中没有.pdata的函数(如32位)大小未知，退回解码指令
+        size_t size=sym.size?sym.size:getFuncCodeSize(sym.address);
+        count++;
+        if(list_only) printf("%s (%zu bytes)\n",name.c_str(),size);
+        else if(bundle_name!=nullptr) bundle.add(name.c_str(),sym.address,size);
+        else {
+            string filename=name+FILEEXT;
+            dumpMemory(sym.address,filename.c_str(),size);
+            printf("Successfully generated %s.\n",filename.c_str());
+        }
+    }
+    if(bundle_name!=nullptr && !list_only) DUMP_BUNDLE(bundle);
+    if(count==0) printf("No matching function found.\n");
+    return 0;
+}
+
+// 声明导入槽，bin_runtime加载bin文件时会填入函数地址，运行时不需要调用env->import和env->getFunc
+// module的格式和env->import的参数相同，symbol为空字符串时使用模块本身的函数，module和symbol须为字符串字面量
+#if defined(__x86_64__)
+#define BIN_IMPORT_FROM(var,module,symbol) \
+    asm volatile("jmp 1f\n\t.ascii \"" IMPORT_SLOT_MAGIC "\"\n"\
+                 "2:\t.quad 0\n\t.asciz \"" module "\"\n\t.asciz \"" symbol "\"\n"\
+                 "1:\n\tmov 2b(%%rip),%0":"=r"(var))
+#elif defined(__i386__)
+#define BIN_IMPORT_FROM(var,module,symbol) \
+    asm volatile("call 0f\n0:\tpop %0\n\tjmp 1f\n\t.ascii \"" IMPORT_SLOT_MAGIC "\"\n"\
+                 "2:\t.long 0\n\t.asciz \"" module "\"\n\t.asciz \"" symbol "\"\n"\
+                 "1:\n\tmov 2b-0b(%0),%0":"=r"(var))
+#endif
+#define BIN_IMPORT(var,module) BIN_IMPORT_FROM(var,module,"")
\ No newline at end of file
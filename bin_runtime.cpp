@@ -2,6 +2,23 @@
 #include "utils.h"
 #include "constants.h"
 #include "libraryloader.h"
+#include "exec_arena.h"
+#include "module_index.h"
+#include "bundle.h"
+#include "module_cache.h"
+#include "epoch_reclaimer.h"
+#include "file_watcher.h"
+#include "concurrent_registry.h"
+#include "task_scheduler.h"
+#include "async_io.h"
+#include "daemon.h"
+#include "call_patcher.h"
+#include "runtime_stats.h"
+#include "profiler.h"
+#include "perf_map.h"
+#include "heap_arena.h"
+#include "module_memory.h"
+#include "runtime_env_trace.h"
 #include <cstdio>
 #include <cstring>
 #include <cerrno>
@@ -10,13 +27,29 @@
 #include <csignal>
 #include <csetjmp>
 #include <string>
+#include <string_view>
+#include <deque>
+#include <map>
+#include <vector>
 #include <unordered_map>
 #include <utility>
+#include <new>
+#include <algorithm>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #ifdef _WIN32
 #include <dbghelp.h>
 #include <Psapi.h>
 #else
 #include <execinfo.h>
+#ifdef __linux__
+#include <stdio_ext.h>
+#endif
+#include <poll.h>
+#include <sys/wait.h>
+#include <ucontext.h>
 #endif
 using namespace std;
 
@@ -32,84 +65,429 @@ const uchar pathsep='/';
 const int current_platform=POSIX;
 #endif
 
-unordered_map<string, LibraryLoader*> loaded_libs;
+extern EpochReclaimer reclaimer;
+StatsCollector runtime_stats; // 始终收集，--stats时在退出前输出
+ConcurrentMap<LibraryLoader*> loaded_libs; // 读取不加锁，释放的库值为nullptr
+mutex libs_mutex; // 加载和释放动态库时加锁
 LibraryLoader *loadLibrary(const char *libname) {
-    auto it = loaded_libs.find(libname);
-    if (it != loaded_libs.end()) {
-        return it->second; // 已找到，直接返回
-    } else {
-        // 未找到，尝试创建新的 LibraryLoader
-        try {
-            LibraryLoader *newLib = new LibraryLoader(libname);
-            loaded_libs[libname] = newLib;
-            return newLib;
-        } catch (runtime_error) {
-            return nullptr; // nullptr 表示加载失败
-        }
+    LibraryLoader *lib = nullptr;
+    if (loaded_libs.find(libname, lib) && lib != nullptr)
+        return lib; // 已找到，直接返回
+    lock_guard<mutex> lock(libs_mutex);
+    if (loaded_libs.find(libname, lib) && lib != nullptr)
+        return lib; // 其他线程已加载
+    // 未找到，尝试创建新的 LibraryLoader
+    try {
+        StatTimer timer(runtime_stats, STAT_LOAD_LIBRARY);
+        LibraryLoader *newLib = new LibraryLoader(libname);
+        loaded_libs.insert(libname, newLib);
+        runtime_stats.addLibrary();
+        return newLib;
+    } catch (runtime_error) {
+        return nullptr; // nullptr 表示加载失败
     }
 }
 void *getLibraryFunc(const char *libname, const char *funcname) {
     LibraryLoader *lib = loadLibrary(libname);
     if(lib == nullptr) return nullptr;
+    StatTimer timer(runtime_stats, STAT_GET_SYMBOL);
     return lib->getSymbol(funcname);
 }
 void freeLibrary(const char *libname) {
-    auto it = loaded_libs.find(libname);
-    if (it != loaded_libs.end()) {
-        LibraryLoader *lib = it->second;
-        delete lib;
-        loaded_libs.erase(it);
+    lock_guard<mutex> lock(libs_mutex);
+    LibraryLoader *lib = nullptr;
+    if (loaded_libs.find(libname, lib) && lib != nullptr) {
+        loaded_libs.insert(libname, nullptr);
+        reclaimer.retire([lib]{delete lib;}); // 其他线程可能正在使用，延迟释放
     } //else {
         //throw runtime_error("Attempt to free an unloaded library");
     //}
 }
 
-void *loadExecutable(const char *filename,size_t *memsize=nullptr){
+int load_mode=LOAD_COPY; // 由命令行选项设置
+// --serve时每个请求的工作目录不同，复用已导入的模块前须确认相对路径仍指向同一个文件
+bool check_module_paths=false;
+unordered_map<string,string> module_paths; // 模块名(.bnd文件带扩展名)到文件的绝对路径，仅check_module_paths时记录
+bool prefault_modules=false;
+int arena_flags=0;size_t arena_align=16;
+ExecArena *exec_arena=nullptr; // 在第一次以LOAD_ARENA方式加载时创建
+mutex arena_mutex;
+void *loadExecutable(const char *filename,size_t *memsize=nullptr,int mode=LOAD_COPY){
+    size_t size;
+    if(mode==LOAD_MMAP){
+        StatTimer timer(runtime_stats,STAT_FILE_MAP);
+        void *func=mapExecFile(filename,&size,prefault_modules);
+        timer.stop();
+        runtime_stats.addModule(size);
+        if(memsize!=nullptr)*memsize=size;
+        return func;
+    }
+    StatTimer open_timer(runtime_stats,STAT_FILE_OPEN);
     FILE *file = fopen(filename, "rb");
     if (file == nullptr)
         throw filenotfound(strerror(errno));
     fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);rewind(file);
-    uchar *buffer = new uchar[size];
+    size = ftell(file);rewind(file);
+    open_timer.stop();
 
-    size_t bytesRead = fread(buffer, 1, size, file);
+    void *func; // 直接读入可执行内存，不经过中间缓冲区
+    StatTimer alloc_timer(runtime_stats,STAT_EXEC_ALLOC);
+    try{
+        if(mode==LOAD_ARENA){
+            lock_guard<mutex> lock(arena_mutex); // 预加载依赖时会在多个线程中调用
+            if(exec_arena==nullptr)
+                exec_arena=new ExecArena(ARENA_CHUNK_SIZE,arena_flags);
+            func=exec_arena->alloc(size,arena_align);
+        } else func=allocExecMemory(size);
+    }catch(runtime_error &){
+        fclose(file);throw;
+    }
+    alloc_timer.stop();
+    StatTimer copy_timer(runtime_stats,STAT_FILE_COPY);
+    size_t bytesRead = fread(func, 1, size, file);
+    fclose(file);
+    copy_timer.stop();
     if (bytesRead != size) {
-        delete[] buffer;fclose(file);
+        if(mode!=LOAD_ARENA)freeExecMemory(func,size);
         throw runtime_error("Error reading file");
     }
-    void *func=allocExecMemory(size);
-    memcpy(func,buffer,size);
+    runtime_stats.addModule(size);
     if(memsize!=nullptr)*memsize=size;
-    delete[] buffer;
     return func;
 }
+mutex heap_arenas_mutex;
+map<size_t,vector<HeapArena *>> module_arenas; // 模块的起始地址到用ARENA_MODULE创建的HeapArena
+void releaseModuleArenas(const ModuleInfo &info){
+    // 释放属于[info.ptr,info.ptr+info.size)中的模块的HeapArena，.bnd文件释放时包括其中所有的函数
+    lock_guard<mutex> lock(heap_arenas_mutex);
+    auto it=module_arenas.lower_bound((size_t)info.ptr);
+    while(it!=module_arenas.end() && it->first<(size_t)info.ptr+info.size){
+        for(HeapArena *arena:it->second) delete arena;
+        it=module_arenas.erase(it);
+    }
+}
+void freeModuleMemory(const ModuleInfo &info){
+    if(info.loadmode!=LOAD_BUNDLE) releaseModuleArenas(info);
+    switch(info.loadmode){
+        case LOAD_MMAP:
+            unmapExecFile(info.ptr,info.size);break;
+        case LOAD_ARENA:
+            break; // 随exec_arena->releaseAll()统一释放
+        case LOAD_BUNDLE:
+            break; // 随所在的.bnd文件释放
+        default:
+            freeExecMemory(info.ptr,info.size);
+    }
+}
+
+// -- 按内容寻址的模块缓存 --
+ModuleCache module_cache; // 内容相同的模块只保留一份
+void discardModuleMemory(const ModuleInfo &info){
+    // 丢弃刚加载、但与缓存中的模块内容相同的副本
+    if(info.loadmode==LOAD_ARENA){
+        lock_guard<mutex> lock(arena_mutex);
+        exec_arena->release(info.ptr,info.size); // 其他线程已在之后分配时无法回收
+    } else freeModuleMemory(info);
+}
+ModuleInfo internModule(const ModuleInfo &info){
+    // 计算模块内容的哈希，已有内容相同的模块时共享它，并释放info的内存
+    if(info.loadmode==LOAD_BUNDLE) return info; // 由所在的.bnd文件管理
+    ModuleHash hash=hashModule(info.ptr,info.size);
+    const ModuleCache::Entry *entry=module_cache.acquire(hash);
+    if(entry==nullptr){
+        module_cache.insert(hash,info);
+        return info;
+    }
+    discardModuleMemory(info);
+    return ModuleInfo{entry->info.ptr,entry->info.size,entry->info.loadmode,info.handle};
+}
+EpochReclaimer reclaimer(freeModuleMemory); // 被替换的模块在所有线程经过静止状态后释放
+void releaseModule(const ModuleInfo &info){
+    // 减少模块的引用计数，不再被任何模块名或导入槽引用时交给reclaimer延迟释放
+    if(info.loadmode==LOAD_BUNDLE) return;
+    vector<ModuleInfo> freed;
+    module_cache.release(info.ptr,freed);
+    for(const ModuleInfo &module:freed) reclaimer.retire(module);
+}
 
+recursive_mutex registry_mutex; // 修改imported_funcs等模块表时加锁，import可能递归调用
+ModuleIndex module_index; // 按地址排序的模块索引，用于栈回溯
+// 以下三个表的读取不加锁，修改时须持有registry_mutex
+AppendOnlyTable<ModuleInfo *> module_table; // 按句柄索引，指向imported_funcs中的元素
+ConcurrentMap<int> module_handles; // 模块名到句柄
+ConcurrentMap<int> import_aliases; // import的参数到句柄，跳过已导入模块的路径解析
+void *getFuncById(int handle){
+    ModuleInfo **entry=(handle<0)?nullptr:module_table.at(handle);
+    if(entry==nullptr) return nullptr;
+    return __atomic_load_n(&(*entry)->ptr,__ATOMIC_ACQUIRE); // 可能正被热重载替换
+}
+ModuleInfo getModuleInfo(int handle){
+    ModuleInfo info=*module_table[handle];
+    info.ptr=getFuncById(handle);
+    return info;
+}
+int resolveBundleFunc(const string &func_name);
+int getModuleHandle(const char *funcname){
+    int handle;
+    if(module_handles.find(funcname,handle)) return handle; // 不加锁
+    lock_guard<recursive_mutex> lock(registry_mutex);
+    if(module_handles.find(funcname,handle)) return handle;
+    return resolveBundleFunc(funcname); // 可能位于已加载的.bnd文件中
+}
 void *getFunc(const char *funcname){
-    string name(funcname);
-    if(imported_funcs.find(name)==imported_funcs.end())
-        return nullptr;
-    return imported_funcs[name].first;
-}
-int import(const char *modname,bool reload=false,void **return_ptr=nullptr){
-    string path(modname);
-    size_t name_start,sep_pos=path.find_last_of(pathsep);
+    return getFuncById(getModuleHandle(funcname));
+}
+string absolutePath(const string &path){
+    // 文件的绝对路径(解析符号链接)，文件不存在时返回空字符串
+#ifdef _WIN32
+    char buf[MAX_PATH];
+    if(_fullpath(buf,path.c_str(),sizeof(buf))==nullptr) return "";
+    if(GetFileAttributesA(buf)==INVALID_FILE_ATTRIBUTES) return "";
+    return buf;
+#else
+    char *resolved=realpath(path.c_str(),nullptr);
+    if(resolved==nullptr) return "";
+    string result=resolved;free(resolved);
+    return result;
+#endif
+}
+void parseModuleName(const char *modname,string &path,string &func_name){
+    // 由import的参数得到文件路径和模块名
+    path=modname;
+    size_t sep_pos=path.find_last_of(pathsep);
     size_t ext_pos=path.find_last_of('.');
     if(ext_pos==string::npos){
         ext_pos=path.size();
         path+=FILEEXT;
     }
-    if(sep_pos==string::npos)name_start=0;
-    else name_start=sep_pos+1;
-    string func_name=path.substr(sep_pos+1,ext_pos-(sep_pos+1));
+    func_name=path.substr(sep_pos+1,ext_pos-(sep_pos+1));
+}
+void linkModule(const string &func_name,const ModuleInfo &info);
+PerfMapWriter *perf_map=nullptr; // --perf-map和--jitdump
+void announceModule(const string &func_name,const void *ptr,size_t size){
+    // 模块映射到新的地址时通知perf
+    if(perf_map!=nullptr) perf_map->moduleLoaded(func_name.c_str(),ptr,size);
+}
+bool patch_env_calls=false; // --patch-env-calls
+EnvCallPatcher *env_call_patcher=nullptr;
+void patchModule(const string &func_name,const ModuleInfo &info){
+    // 将模块中的env->xxx(...)改写为直接调用，须在其他线程能执行模块之前调用
+    if(env_call_patcher==nullptr) return;
+    if(load_mode==LOAD_MMAP) makeExecWritable(info.ptr,info.size); // 只有被修改的页面不再共享
+    env_call_patcher->patch(info.ptr,info.size);
+}
+int addModule(const string &func_name,const char *modname,ModuleInfo info){
+    // 将加载的模块加入imported_funcs，重新加载时替换原有模块，返回模块的句柄
+    auto it=imported_funcs.find(func_name);
+    bool is_new=(it==imported_funcs.end());
+    if(!is_new) info.handle=it->second.handle;
+    else info.handle=module_table.size();
+    // 内容相同的模块共享已改写的代码和已填入的导入槽
+    bool first_link=(info.loadmode==LOAD_BUNDLE || module_cache.markLinked(info.ptr));
+    unsigned long long link_ns=0;
+    if(first_link){
+        unsigned long long start=StatsCollector::now();
+        patchModule(func_name,info);
+        link_ns=StatsCollector::now()-start;
+    }
+    ModuleInfo &entry=imported_funcs[func_name];
+    entry.size=info.size;entry.loadmode=info.loadmode;entry.handle=info.handle;
+    __atomic_store_n(&entry.ptr,info.ptr,__ATOMIC_RELEASE); // 最后发布函数地址
+    announceModule(func_name,info.ptr,info.size);
+    if(is_new){ // 先加入module_table，其他线程通过句柄查找时不会越界
+        module_table.push_back(&entry);
+        module_handles.insert(func_name,info.handle);
+    }
+    module_index.rebuild(imported_funcs);
+    int alias;
+    if(!import_aliases.find(modname,alias)) import_aliases.insert(modname,info.handle);
+    // 先加入imported_funcs，使循环导入能够找到当前模块
+    if(first_link){ // 计时包括导入槽引用的模块的导入
+        unsigned long long start=StatsCollector::now();
+        linkModule(func_name,info);
+        runtime_stats.record(STAT_LINK,link_ns+StatsCollector::now()-start);
+    }
+    return info.handle;
+}
+// -- .bnd文件 --
+struct LoadedBundle{
+    string name;
+    ModuleInfo info; // 整个.bnd文件映射的内存
+};
+vector<LoadedBundle> loaded_bundles;
+bool isBundlePath(const string &path){
+    size_t ext_len=strlen(BUNDLEEXT);
+    return path.size()>=ext_len &&
+           path.compare(path.size()-ext_len,ext_len,BUNDLEEXT)==0;
+}
+int resolveBundleFunc(const string &func_name){
+    // 在已加载的.bnd文件的哈希表中查找函数，找到时加入imported_funcs，返回句柄
+    for(const LoadedBundle &bundle:loaded_bundles){
+        const BundleEntry *entry=findBundleEntry(bundle.info.ptr,func_name.c_str());
+        if(entry!=nullptr){
+            ModuleInfo info{(char *)bundle.info.ptr+entry->code_offset,
+                            (size_t)entry->code_size,LOAD_BUNDLE,INVALID_HANDLE};
+            return addModule(func_name,func_name.c_str(),info);
+        }
+    }
+    return INVALID_HANDLE;
+}
+ModuleInfo addBundle(const string &bundle_name,ModuleInfo info){
+    // .bnd文件中的函数在第一次被查找时才加入imported_funcs，返回共享后的内存
+    if(!validateBundle(info.ptr,info.size)){
+        freeModuleMemory(info);
+        throw invalid_argument("Invalid bundle file");
+    }
+    info=internModule(info);
+    for(LoadedBundle &bundle:loaded_bundles){
+        if(bundle.name==bundle_name){ // 重新加载，更新已查找过的函数的地址
+            ModuleInfo old=bundle.info;
+            if(old.ptr==info.ptr){ // 内容未改变
+                releaseModule(info);
+                return info;
+            }
+            size_t old_start=(size_t)old.ptr,old_end=old_start+old.size;
+            bundle.info=info;
+            for(auto &[func_name,func_info]:imported_funcs){
+                if((size_t)func_info.ptr<old_start || (size_t)func_info.ptr>=old_end)
+                    continue;
+                const BundleEntry *entry=findBundleEntry(info.ptr,func_name.c_str());
+                if(entry!=nullptr){
+                    func_info.size=entry->code_size;
+                    __atomic_store_n(&func_info.ptr,(void *)((char *)info.ptr+entry->code_offset),
+                                     __ATOMIC_RELEASE);
+                    announceModule(func_name,func_info.ptr,func_info.size);
+                } else func_info.size=0; // 新版本中已删除的函数
+            }
+            module_index.rebuild(imported_funcs);
+            releaseModule(old);
+            return info;
+        }
+    }
+    loaded_bundles.push_back(LoadedBundle{bundle_name,info});
+    return info;
+}
+const char *firstBundleFunc(const string &bundle_name){
+    for(const LoadedBundle &bundle:loaded_bundles){
+        if(bundle.name==bundle_name &&
+           ((const BundleHeader *)bundle.info.ptr)->entry_count>0)
+            return bundleEntryName(bundle.info.ptr,bundleEntries(bundle.info.ptr)[0]);
+    }
+    return nullptr;
+}
 
-    if(imported_funcs.find(func_name)!=imported_funcs.end() && !reload){
+int replaceModule(const string &func_name,const char *modname,const ModuleInfo &loaded){
+    // 加入新加载的模块，已存在时原地替换，内容未改变时不做任何操作，返回模块的句柄
+    ModuleInfo info=internModule(loaded);
+    auto it=imported_funcs.find(func_name);
+    if(it==imported_funcs.end()) return addModule(func_name,modname,info);
+    ModuleInfo old=it->second;
+    if(old.ptr==info.ptr){
+        releaseModule(info);
+        return old.handle;
+    }
+    int handle=addModule(func_name,modname,info);
+    releaseModule(old); // 旧的内存不再被引用后延迟释放
+    return handle;
+}
+// -- 热重载 --
+bool watch_modules=false; // 由--watch设置
+FileWatcher *module_watcher=nullptr;
+void watchModule(const string &path){
+    // 保存为绝对路径，--serve时相对路径基于请求的工作目录，之后重新加载时工作目录已改变
+    // 不解析符号链接，替换链接本身时也能察觉
+    if(module_watcher==nullptr) return;
+#ifdef _WIN32
+    char buf[MAX_PATH];
+    module_watcher->add(_fullpath(buf,path.c_str(),sizeof(buf))?buf:path);
+#else
+    char cwd[4096];
+    if(path[0]=='/' || getcwd(cwd,sizeof(cwd))==nullptr) module_watcher->add(path);
+    else module_watcher->add(string(cwd)+"/"+path);
+#endif
+}
+void hotReload(const string &path){
+    // 在监视线程中调用，在锁外读取文件，之后原地替换模块，正在执行旧代码的调用不受影响
+    string unused,func_name;
+    parseModuleName(path.c_str(),unused,func_name);
+    try{
+        size_t size;
+        void *ptr=loadExecutable(path.c_str(),&size,load_mode);
+        lock_guard<recursive_mutex> lock(registry_mutex);
+        ModuleInfo info{ptr,size,load_mode,INVALID_HANDLE};
+        if(isBundlePath(path)) addBundle(func_name,info);
+        else replaceModule(func_name,path.c_str(),info);
+        fprintf(stderr,"Reloaded %s\n",path.c_str());
+    }catch(exception &err){
+        fprintf(stderr,"Warning: cannot reload %s: %s\n",path.c_str(),err.what());
+    }
+}
+
+int import(const char *modname,bool reload=false,ModuleInfo *return_info=nullptr){
+    int handle;
+    if(!reload && !check_module_paths && import_aliases.find(modname,handle)){ // 以相同的参数导入过，不加锁直接返回
+        if(return_info!=nullptr)*return_info=getModuleInfo(handle);
+        return IMPORT_SUCCESS; // 不计时，避免热路径上读取时钟
+    }
+    StatTimer import_timer(runtime_stats,STAT_IMPORT);
+    StatTimer resolve_timer(runtime_stats,STAT_RESOLVE_PATH); // 需要读取文件时提前结束
+    lock_guard<recursive_mutex> lock(registry_mutex);
+    string path,func_name;
+    parseModuleName(modname,path,func_name);
+    string real_path;
+    if(check_module_paths) real_path=absolutePath(path);
+    auto samePath=[&](const string &key){ // 已导入的模块是否来自当前路径指向的文件
+        if(!check_module_paths) return true;
+        auto found=module_paths.find(key);
+        return found==module_paths.end() || found->second==real_path; // 未记录的如.bnd中的函数
+    };
+    if(isBundlePath(path)){
+        for(const LoadedBundle &bundle:loaded_bundles){
+            if(bundle.name==func_name && !reload && samePath(func_name+BUNDLEEXT)){
+                if(return_info!=nullptr)*return_info=bundle.info;
+                return IMPORT_SUCCESS;
+            }
+        }
+        resolve_timer.stop();
+        try{
+            size_t size;
+            void *ptr=loadExecutable(path.c_str(),&size,load_mode);
+            ModuleInfo info=addBundle(func_name,ModuleInfo{ptr,size,load_mode,INVALID_HANDLE});
+            if(!reload) watchModule(path);
+            if(check_module_paths) module_paths[func_name+BUNDLEEXT]=real_path;
+            if(return_info!=nullptr)*return_info=info;
+        }catch(const filenotfound &){
+            return MODULE_NOT_FOUND;
+        }catch(const invalid_argument &){
+            return INVALID_MODULE;
+        }catch(const runtime_error &){
+            return UNKNOWN_ERROR;
+        }
+        return IMPORT_SUCCESS;
+    }
+
+    auto it=imported_funcs.find(func_name);
+    if(it!=imported_funcs.end() && !reload && samePath(func_name)){
+        if(return_info!=nullptr)*return_info=it->second;
+        import_aliases.insert(modname,it->second.handle);
         return IMPORT_SUCCESS; // 模块已存在，并且不重新加载
     }
+    if(it==imported_funcs.end()){ // 位于已加载的.bnd文件中，不需要读取文件
+        handle=resolveBundleFunc(func_name);
+        if(handle!=INVALID_HANDLE){
+            if(return_info!=nullptr)*return_info=*module_table[handle];
+            return IMPORT_SUCCESS;
+        }
+    }
+    resolve_timer.stop();
     try{
         size_t size;
-        void *funcptr=loadExecutable(path.c_str(),&size);
-        if(return_ptr!=nullptr)*return_ptr=funcptr;
-        imported_funcs[func_name]=pair<void *,size_t>(funcptr,size);
+        void *funcptr=loadExecutable(path.c_str(),&size,load_mode);
+        handle=replaceModule(func_name,modname,
+                                 ModuleInfo{funcptr,size,load_mode,INVALID_HANDLE});
+        if(it==imported_funcs.end()) watchModule(path);
+        if(check_module_paths) module_paths[func_name]=real_path;
+        if(return_info!=nullptr)*return_info=*module_table[handle];
     }catch(filenotfound){
         return MODULE_NOT_FOUND;
     }catch(runtime_error){
@@ -117,45 +495,221 @@ int import(const char *modname,bool reload=false,void **return_ptr=nullptr){
     }
     return IMPORT_SUCCESS;
 }
+void *resolveImportSlot(const char *module,const char *symbol){
+    ModuleInfo info;string path,func_name;
+    if(import(module,false,&info)!=IMPORT_SUCCESS) return nullptr;
+    if(*symbol!='\0') return getFunc(symbol);
+    parseModuleName(module,path,func_name);
+    return isBundlePath(path)?nullptr:info.ptr; // .bnd文件须指定函数名
+}
+void linkModule(const string &func_name,const ModuleInfo &info){
+    // 查找模块中由BIN_IMPORT声明的导入槽，并填入函数地址
+    const size_t magic_len=strlen(IMPORT_SLOT_MAGIC);
+    uchar *cur=(uchar *)info.ptr,*end=cur+info.size;
+    bool writable=(load_mode!=LOAD_MMAP);
+    while((size_t)(end-cur)>=magic_len){
+        uchar *found=(uchar *)find_submem(cur,end-cur,IMPORT_SLOT_MAGIC,magic_len);
+        if(found==nullptr) break;
+        uchar *slot=found+magic_len;
+        const char *module=(const char *)slot+sizeof(void *);
+        const char *module_end=(const char *)memchr(module,'\0',end-(uchar *)module);
+        const char *symbol=module_end?module_end+1:nullptr;
+        if(symbol==nullptr || memchr(symbol,'\0',end-(uchar *)symbol)==nullptr){
+            fprintf(stderr,"Warning: malformed import slot in %s\n",func_name.c_str());
+            break;
+        }
+        void *target=resolveImportSlot(module,symbol);
+        if(target==nullptr)
+            fprintf(stderr,"Warning: unresolved import %s%s%s in %s\n",module,
+                    *symbol?":":"",symbol,func_name.c_str());
+        if(!writable){ // 映射的文件改为写时复制，只有被修改的页面不再共享
+            makeExecWritable(info.ptr,info.size);
+            writable=true;
+        }
+        memcpy(slot,&target,sizeof(void *));
+        if(target!=nullptr) module_cache.addDependency(info.ptr,target); // 被引用的模块不会被释放
+        cur=(uchar *)symbol+strlen(symbol)+1;
+    }
+}
+void quiescentState(){
+    // 当前线程不再持有之前获取的函数指针，之前被替换的模块可以释放
+    reclaimer.quiescent();
+    reclaimer.reclaim();
+}
+int importModule(const char *modname,int *handle){
+    ModuleInfo info;
+    int result=import(modname,false,&info);
+    if(handle!=nullptr)
+        *handle=(result==IMPORT_SUCCESS)?info.handle:INVALID_HANDLE;
+    return result;
+}
 int forceReload(const char *modname){
-    return import(modname,true);
+    int result=import(modname,true);
+    quiescentState(); // 调用者之后不再使用旧的函数指针
+    return result;
 }
 int loadModule(const char *modname){
     return import(modname,false);
 }
+// -- 依赖声明与并行预加载 --
+unsigned int preload_jobs=0; // 预加载依赖的线程数，0表示使用CPU核心数(最多8个)
+vector<string> readDependencies(const string &path){
+    // 读取模块的.deps文件，每行是一个import参数格式的模块名，#开头的行为注释
+    vector<string> deps;
+    string deps_path=path;
+    size_t ext_len=strlen(FILEEXT);
+    if(deps_path.size()>=ext_len &&
+       deps_path.compare(deps_path.size()-ext_len,ext_len,FILEEXT)==0)
+        deps_path.resize(deps_path.size()-ext_len);
+    deps_path+=DEPSEXT;
+    FILE *file=fopen(deps_path.c_str(),"r");
+    if(file==nullptr) return deps; // 没有声明依赖
+    char line[4096];
+    while(fgets(line,sizeof(line),file)!=nullptr){
+        char *start=line,*end=line+strlen(line);
+        while(*start==' ' || *start=='\t')start++;
+        while(end>start && isspace((unsigned char)end[-1]))end--;
+        *end='\0';
+        if(*start!='\0' && *start!='#') deps.emplace_back(start);
+    }
+    fclose(file);
+    return deps;
+}
+void preloadDependencies(const char *modname){
+    // 在调用入口函数之前，解析完整的依赖图，并用多个线程同时加载互不依赖的模块
+    struct PendingModule{
+        string modname,path,func_name;
+        ModuleInfo info;
+        string error;
+    };
+    string root_path,root_name;
+    parseModuleName(modname,root_path,root_name);
+
+    mutex lock;condition_variable cond;
+    deque<PendingModule *> queue;
+    vector<PendingModule *> finished;
+    unordered_set<string> seen{root_name};
+    size_t active=0;
+    auto enqueue=[&](const vector<string> &deps){ // 调用时须持有lock
+        for(const string &dep:deps){
+            int handle;
+            PendingModule *pending=new PendingModule{dep,"","",ModuleInfo{},""};
+            parseModuleName(dep.c_str(),pending->path,pending->func_name);
+            if(!seen.insert(pending->func_name).second ||
+               module_handles.find(pending->func_name,handle)){
+                delete pending;continue;
+            }
+            queue.push_back(pending);
+        }
+        cond.notify_all();
+    };
+    {
+        unique_lock<mutex> guard(lock);
+        enqueue(readDependencies(root_path));
+        if(queue.empty()) return;
+    }
+    auto worker=[&](){
+        unique_lock<mutex> guard(lock);
+        while(true){
+            cond.wait(guard,[&]{return !queue.empty() || active==0;});
+            if(queue.empty()) return; // 没有正在加载的模块，不会再产生新的依赖
+            PendingModule *pending=queue.front();queue.pop_front();
+            active++;
+            guard.unlock();
+            vector<string> deps;
+            try{
+                size_t size;
+                void *funcptr=loadExecutable(pending->path.c_str(),&size,load_mode);
+                pending->info=ModuleInfo{funcptr,size,load_mode,INVALID_HANDLE};
+                deps=readDependencies(pending->path);
+            }catch(exception &err){
+                pending->error=err.what();
+            }
+            guard.lock();
+            finished.push_back(pending);
+            enqueue(deps);
+            active--;
+            cond.notify_all();
+        }
+    };
+    unsigned int jobs=preload_jobs;
+    if(jobs==0) jobs=max(1u,min(thread::hardware_concurrency(),8u));
+    jobs=min<size_t>(jobs,queue.size()); // 线程尚未启动，不需要加锁；之后发现的依赖由已有的线程加载
+    vector<thread> threads;
+    for(unsigned int i=1;i<jobs;i++) threads.emplace_back(worker);
+    worker();
+    for(thread &t:threads) t.join();
+
+    lock_guard<recursive_mutex> registry_lock(registry_mutex);
+    for(PendingModule *pending:finished){ // 在主线程中统一注册
+        if(pending->error.empty()){
+            try{
+                if(isBundlePath(pending->path)) addBundle(pending->func_name,pending->info);
+                else addModule(pending->func_name,pending->modname.c_str(),
+                               internModule(pending->info));
+                watchModule(pending->path);
+            }catch(invalid_argument &err){
+                fprintf(stderr,"Warning: cannot preload %s: %s\n",
+                        pending->modname.c_str(),err.what());
+            }
+        } else
+            fprintf(stderr,"Warning: cannot preload %s: %s\n",
+                    pending->modname.c_str(),pending->error.c_str());
+        delete pending;
+    }
+}
+
 void debugModuleInfo(){
+    lock_guard<recursive_mutex> lock(registry_mutex);
     size_t total_size=0;char *converted;
     printf("Loaded modules:\n");
     for(auto &[func_name,value]:imported_funcs){
-        size_t size=value.second;
+        size_t size=value.size;
         converted=convert_size(size);
-        printf("%s (%s)\n",func_name.c_str(),converted);
+        printf("%s (%s",func_name.c_str(),converted);
         delete converted;
+        ModuleMemoryStats usage;
+        if(MemoryAccountant::active!=nullptr &&
+           MemoryAccountant::active->usage(func_name.c_str(),nullptr,usage)){
+            char *live=convert_size(usage.live_bytes);
+            converted=convert_size(usage.peak_bytes);
+            printf(", heap %s live / %s peak, %llu open file(s)",live,converted,usage.open_files);
+            delete live;delete converted;
+        }
+        printf(")\n");
         total_size+=size;
     }
     converted=convert_size(total_size);
-    printf("Total module memory: %s\n\n",converted);
+    printf("Total module memory: %s\n",converted);
     delete converted;
-    printf("Loaded libraries:\n");
-    if(loaded_libs.empty()){
-        printf("(No libraries loaded)\n\n");
-    } else {
-        for(auto &[libname,lib]:loaded_libs){
-            printf("%s (0x%llx)\n",libname.c_str(),lib->handle);
-        }
-        printf("\n");
+    if(exec_arena!=nullptr){
+        char *used=convert_size(exec_arena->usedBytes());
+        converted=convert_size(exec_arena->mappedBytes());
+        printf("Executable arena: %s used / %s mapped in %zu chunk(s)\n",
+               used,converted,exec_arena->chunkCount());
+        delete used;delete converted;
     }
+    if(env_call_patcher!=nullptr)
+        printf("Patched env calls: %zu (%zu trampolines)\n",
+               env_call_patcher->patchedCount(),env_call_patcher->trampolineCount());
+    printf("\n");
+    printf("Loaded libraries:\n");
+    lock_guard<mutex> libs_lock(libs_mutex);
+    size_t lib_count=0;
+    loaded_libs.forEach([&](string_view libname,LibraryLoader *lib){
+        if(lib==nullptr) return; // 已释放
+        printf("%.*s (0x%llx)\n",(int)libname.size(),libname.data(),
+               (unsigned long long)lib->handle);
+        lib_count++;
+    });
+    if(lib_count==0) printf("(No libraries loaded)\n");
+    printf("\n");
 }
 pair<string,void *> findModuleByAddress(void *stack_address){
-    size_t address=(size_t)stack_address;
-    for(const auto &[name,info]:imported_funcs){
-        size_t addr=(size_t)info.first;
-        size_t size=info.second;
-        if(address>=(size_t)addr && address<(size_t)addr+size){
-            return pair<string,void *>(name,info.first);
-        }
-    }
-    return make_pair<string,void *>("",nullptr);
+    const ModuleRange *range=module_index.find((size_t)stack_address);
+    if(range==nullptr)
+        return make_pair<string,void *>("",nullptr);
+    return pair<string,void *>(range->name,(void *)range->start);
 }
 #ifdef _WIN32
 void stackTrace() {  
@@ -223,16 +777,25 @@ void stackTrace() {
     SymCleanup(process);
 }
 #else
-void stackTrace() {
-    void *array[MAX_STACKTRACE_SIZE];  
-    size_t size;  
+void printStackFrames(void **frames,size_t count){
+    fprintf(stderr, "Stacktrace:\n");
+    for(size_t i=0;i<count;i++){
+        if(module_index.find((size_t)frames[i])!=nullptr)
+            writeFrame(STDERR_FILENO,module_index,frames[i]); // 系统无法获取bin文件的符号
+        else
+            backtrace_symbols_fd(&frames[i],1,STDERR_FILENO);
+    }
+}
+__attribute__((noinline)) void stackTrace() {
+    void *array[MAX_STACKTRACE_SIZE],*fp_array[MAX_STACKTRACE_SIZE];
 
-    // 获取堆栈中的地址  
-    size = backtrace(array, MAX_STACKTRACE_SIZE);  
+    // 获取堆栈中的地址，backtrace依赖调试信息，无法越过bin文件的帧，因此同时使用帧指针回溯
+    size_t size = backtrace(array, MAX_STACKTRACE_SIZE);
+    size_t fp_size = unwindFramePointers(fp_array,MAX_STACKTRACE_SIZE,__builtin_frame_address(0));
 
-    // 打印堆栈信息  
-    fprintf(stderr, "Stacktrace:\n");
-    backtrace_symbols_fd(array, size, STDERR_FILENO);
+    // 打印堆栈信息
+    if(fp_size>size) printStackFrames(fp_array,fp_size);
+    else printStackFrames(array,size);
 }
 #endif
 FILE *getstdin(){return stdin;} // stdin为调用__acrt_iob_func的宏
@@ -240,8 +803,69 @@ FILE *getstdout(){return stdout;}
 FILE *getstderr(){return stderr;}
 void abort_(){raise(SIGABRT);} // 不使用标准库的abort
 
-static RuntimeEnv *runtime_env=new RuntimeEnv();
+static RuntimeEnv *runtime_env=nullptr; // 在main中创建，计入STAT_RUNTIME_INIT
 using ExecutableMain=int (*)(int,const char**,RuntimeEnv*);
+int guardedCall(int (*func)(void *),void *arg);
+void registerThread();
+void unregisterThread();
+void *spawnTask(int (*func)(void *),void *arg);
+int joinTask(void *task);
+int parallelFor(long long begin,long long end,long long grain,
+                void (*func)(long long,long long,void *),void *ctx);
+int ioSubmit(const IoRequest *requests,int count){
+    return AsyncIO::current().submit(requests,count);
+}
+int ioWait(IoCompletion *completions,int max,int timeout_ms){
+    return AsyncIO::current().wait(completions,max,timeout_ms);
+}
+size_t getStats(RuntimeStats *stats,size_t size){
+    return runtime_stats.snapshot(stats,size);
+}
+size_t getModuleMemory(const char *module,ModuleMemoryStats *stats,size_t size){
+    // 未使用--mem-track或模块尚未分配过内存时返回0
+    ModuleMemoryStats result;
+    if(MemoryAccountant::active==nullptr ||
+       !MemoryAccountant::active->usage(module,__builtin_return_address(0),result)) return 0;
+    size=min(size,sizeof(result));
+    memcpy(stats,&result,size);
+    return size;
+}
+size_t findCallerModule(void *return_address){
+    // 返回调用者所在模块的起始地址，不在模块中时为0
+    const ModuleRange *range=findCallerRange(module_index,return_address);
+    return range?range->start:0;
+}
+void *arenaCreate(size_t chunk_size,int flags){
+    size_t owner=(flags&ARENA_MODULE)?findCallerModule(__builtin_return_address(0)):0;
+    HeapArena *arena=new(nothrow) HeapArena(chunk_size,owner);
+    if(arena!=nullptr && MemoryAccountant::active!=nullptr) // 块计入创建者所在的模块，受--mem-quota限制
+        MemoryAccountant::active->trackArena(*arena,__builtin_return_address(0));
+    if(arena!=nullptr && owner!=0){
+        lock_guard<mutex> lock(heap_arenas_mutex);
+        module_arenas[owner].push_back(arena);
+    }
+    return arena;
+}
+void *arenaAlloc(void *arena,size_t size){
+    return ((HeapArena *)arena)->alloc(size);
+}
+void arenaReset(void *arena){
+    ((HeapArena *)arena)->reset();
+}
+void arenaDestroy(void *arena){
+    if(arena==nullptr) return;
+    HeapArena *heap_arena=(HeapArena *)arena;
+    if(heap_arena->owner!=0){
+        lock_guard<mutex> lock(heap_arenas_mutex);
+        auto it=module_arenas.find(heap_arena->owner);
+        if(it!=module_arenas.end()){
+            vector<HeapArena *> &arenas=it->second;
+            arenas.erase(remove(arenas.begin(),arenas.end(),heap_arena),arenas.end());
+            if(arenas.empty()) module_arenas.erase(it);
+        }
+    }
+    delete heap_arena;
+}
 void initRuntimeEnv(RuntimeEnv *runtime_env){
     runtime_env->version=RuntimeVersion{RUNTIME_VERSION_MAJOR,
         RUNTIME_VERSION_MINOR,RUNTIME_VERSION_REVISION};
@@ -256,23 +880,163 @@ void initRuntimeEnv(RuntimeEnv *runtime_env){
     runtime_env->getstderr=getstderr;
     runtime_env->stackTrace=stackTrace;
     runtime_env->abort=abort_;
+    runtime_env->importModule=importModule;
+    runtime_env->getFuncById=getFuncById;
+    runtime_env->getModuleHandle=getModuleHandle;
+    runtime_env->reloadModule=forceReload;
+    runtime_env->quiescentState=quiescentState;
+    runtime_env->registerThread=registerThread;
+    runtime_env->unregisterThread=unregisterThread;
+    runtime_env->guardedCall=guardedCall;
+    runtime_env->spawn=spawnTask;
+    runtime_env->join=joinTask;
+    runtime_env->parallelFor=parallelFor;
+    runtime_env->ioSubmit=ioSubmit;
+    runtime_env->ioWait=ioWait;
+    runtime_env->fileno=::fileno; // 获取fopen打开的文件的文件描述符，用于ioSubmit
+    runtime_env->getStats=getStats;
+    runtime_env->arenaCreate=arenaCreate;
+    runtime_env->arenaAlloc=arenaAlloc;
+    runtime_env->arenaReset=arenaReset;
+    runtime_env->arenaDestroy=arenaDestroy;
+    runtime_env->getModuleMemory=getModuleMemory;
+    runtime_env->memmem=findBytes; // msvcrt没有memmem
 }
-int execExecutable(const char *filename,int argc,const char *argv[]){
-    // argv的第0项是程序目录，从第1项开始是命令行参数
-    size_t size;ExecutableMain mainfunc;
-    int import_result=import(filename,&size,(void**)(&mainfunc));
+string entry_func; // 运行.bnd文件时的入口函数名
+thread_local bool fault_guard=false; // 当前线程是否已用setjmp设置jmp_env
+#ifndef _WIN32
+thread_local void *fault_frames[MAX_STACKTRACE_SIZE];thread_local size_t fault_frame_count=0;
+void fault_handler(int signum,siginfo_t *info,void *ucontext){
+    if(!fault_guard){ // 没有恢复点的线程，恢复默认处理方式并重新发送信号，结束进程
+        signal(signum,SIG_DFL); // raise发送的SIGABRT等不会在返回后重新触发，不能直接返回
+        raise(signum); // SA_NODEFER，信号不被屏蔽，立即以默认方式处理
+        _exit(128+signum);
+    }
+    // 跳出之前记录出错位置的调用栈，longjmp之后出错的栈帧已被覆盖
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+    const mcontext_t &context=((ucontext_t *)ucontext)->uc_mcontext;
+#ifdef __x86_64__
+    void *pc=(void *)context.gregs[REG_RIP],*fp=(void *)context.gregs[REG_RBP];
+    void *sp=(void *)context.gregs[REG_RSP];
+#else
+    void *pc=(void *)context.gregs[REG_EIP],*fp=(void *)context.gregs[REG_EBP];
+    void *sp=(void *)context.gregs[REG_ESP];
+#endif
+    // 第一帧为出错的指令，比从信号处理函数回溯得到的栈更准确，总是使用
+    fault_frame_count=unwindSignalContext(module_index,fault_frames,MAX_STACKTRACE_SIZE,fp,pc,sp);
+#else
+    fault_frame_count=unwindFramePointers(fault_frames,MAX_STACKTRACE_SIZE,
+                                          __builtin_frame_address(0));
+#endif
+    longjmp(jmp_env,signum);
+}
+void setFaultHandler(int signum){
+    struct sigaction action;
+    memset(&action,0,sizeof(action));
+    action.sa_sigaction=fault_handler;
+    action.sa_flags=SA_SIGINFO|SA_NODEFER; // longjmp跳出后不会恢复信号屏蔽字
+    sigemptyset(&action.sa_mask);
+    sigaction(signum,&action,nullptr);
+}
+#else
+void setFaultHandler(int signum){
+    signal(signum, signal_handler);
+}
+#endif
+int guardedCall(int (*func)(void *),void *arg){
+    // 在当前线程中调用func，段错误或abort只结束这次调用，返回INT_MAX，可以嵌套调用
+    jmp_buf saved_env;bool saved_guard=fault_guard;
+    memcpy(saved_env,jmp_env,sizeof(jmp_buf));
+    int result,signum;
+    fault_guard=true;
+    if((signum=setjmp(jmp_env))==0){
+        result=func(arg);
+    } else {
+        fprintf(stderr,"Caught signal %d in guarded call\n",signum);
+#ifdef _WIN32
+        stackTrace();
+#else
+        printStackFrames(fault_frames,fault_frame_count);
+#endif
+        result=INT_MAX;
+    }
+    memcpy(jmp_env,saved_env,sizeof(jmp_buf));
+    fault_guard=saved_guard;
+    return result;
+}
+void registerThread(){
+    reclaimer.registerThread(); // 注册后线程须定期调用quiescentState
+}
+void unregisterThread(){
+    reclaimer.unregisterThread();
+}
+unsigned int worker_threads=0; // 任务调度器的线程数，0表示使用CPU核心数
+TaskScheduler *scheduler=nullptr;
+// 任务在工作线程中通过guardedCall执行，出错时只结束这个任务
+void *spawnTask(int (*func)(void *),void *arg){
+    return scheduler->spawn(func,arg);
+}
+int joinTask(void *task){
+    return scheduler->join(task);
+}
+int parallelFor(long long begin,long long end,long long grain,
+                void (*func)(long long,long long,void *),void *ctx){
+    return scheduler->parallelFor(begin,end,grain,func,ctx);
+}
+void initExecution(){
+    // 运行模块之前的准备，每个进程只调用一次
+    reclaimer.registerThread(); // 主线程运行模块代码
+    scheduler=new TaskScheduler(worker_threads,&reclaimer,guardedCall); // 工作线程在第一次提交任务时创建
+    if(watch_modules)
+        module_watcher=new FileWatcher(hotReload,[]{
+            lock_guard<recursive_mutex> lock(registry_mutex); // --fork时父进程持有registry_mutex来fork
+            reclaimer.reclaim();
+        });
+}
+void finishExecution(){
+    delete scheduler;scheduler=nullptr; // 等待已提交的任务执行完
+    if(module_watcher!=nullptr){
+        module_watcher->stop();
+        delete module_watcher;module_watcher=nullptr;
+    }
+}
+ModuleInfo importEntry(const char *filename,const string &entry_name){
+    // 导入主模块，返回入口函数所在的模块，失败时抛出runtime_error
+    ModuleInfo info;
+    int import_result=import(filename,false,&info);
     if(import_result!=0)
         throw runtime_error(
             "Import main module failed with code "+to_string(import_result));
-    signal(SIGABRT, signal_handler);
-    signal(SIGSEGV, signal_handler);int signum;
+    string path,bundle_name;
+    parseModuleName(filename,path,bundle_name);
+    if(isBundlePath(path)){ // 运行.bnd文件中的入口函数，默认为第一个函数
+        const char *entry=entry_name.empty()?firstBundleFunc(bundle_name):entry_name.c_str();
+        int handle=(entry!=nullptr)?getModuleHandle(entry):INVALID_HANDLE;
+        if(handle==INVALID_HANDLE)
+            throw runtime_error("Entry function not found in "+path);
+        info=*module_table[handle];
+    }
+    preloadDependencies(filename);
+    return info;
+}
+const int EXIT_REQUESTED=-1; // env->exit在--serve模式下跳出时setjmp的返回值
+int exit_status=0;
+int runMain(const char *filename,ExecutableMain mainfunc,int argc,const char *argv[]){
+    // 在恢复点中调用入口函数，出错时输出调试信息并返回INT_MAX
+    setFaultHandler(SIGABRT);
+    setFaultHandler(SIGSEGV);int signum;
+    fault_guard=true;
     if((signum=setjmp(jmp_env))==0){
         int result=mainfunc(argc,argv,runtime_env);
+        fault_guard=false;
         signal(SIGABRT, SIG_DFL);signal(SIGSEGV, SIG_DFL);
-        freeExecMemory((void *)mainfunc,size);
         return result;
     }else{
+        fault_guard=false;
+        signal(SIGABRT, SIG_DFL);signal(SIGSEGV, SIG_DFL);
         switch(signum){
+            case EXIT_REQUESTED:
+                return exit_status;
             case SIGABRT:
                 printf("%s called abort(), exiting\n",filename);break;
             case SIGSEGV:
@@ -280,19 +1044,438 @@ int execExecutable(const char *filename,int argc,const char *argv[]){
             default:
                 printf("Caught signal %d from %s\n",signum,filename);
         }
+        fflush(stdout);
+#ifdef _WIN32
         stackTrace();
-        signal(SIGABRT, SIG_DFL);signal(SIGSEGV, SIG_DFL);
-        freeExecMemory((void *)mainfunc,size);
+#else
+        printStackFrames(fault_frames,fault_frame_count);
+#endif
         return INT_MAX;
     }
 }
+int execExecutable(const char *filename,int argc,const char *argv[]){
+    // argv的第0项是程序目录，从第1项开始是命令行参数
+    initExecution();
+    ModuleInfo info=importEntry(filename,entry_func);
+    if(module_watcher!=nullptr) module_watcher->start();
+    int result=runMain(filename,(ExecutableMain)info.ptr,argc,argv);
+    finishExecution();
+    releaseModule(*module_table[info.handle]); // 入口模块可能已被热重载替换
+    reclaimer.unregisterThread(); // 没有其他线程时释放所有被替换的模块
+    return result;
+}
+
+#ifndef _WIN32
+// -- --serve守护进程模式 --
+string serve_socket; // --serve的套接字路径
+string client_socket; // --client的套接字路径
+volatile sig_atomic_t serve_stopping=0;
+bool forked_child=false; // 当前进程是否为--fork的子进程
+[[noreturn]] void serveExit(int status) noexcept{
+    // --serve模式下env->exit只结束当前请求，不结束服务端进程
+    if(!fault_guard){ // 不在入口函数的调用中(如其他线程)
+        if(forked_child){ // 不执行从父进程继承的atexit(--stats、--profile等的报告)
+            fflush(nullptr);
+            _exit(status);
+        }
+        exit(status);
+    }
+    exit_status=status;
+    longjmp(jmp_env,EXIT_REQUESTED);
+}
+void resetStdin(){
+    // 丢弃上一个请求残留在stdin缓冲区中的数据和EOF标记
+#ifdef __linux__
+    __fpurge(stdin);
+#else
+    fflush(stdin);
+#endif
+    clearerr(stdin);
+}
+int handleRequest(ServeRequest &request){
+    // 在客户端的工作目录中，以客户端的标准输入输出运行请求的模块
+    vector<const char *> argv;
+    for(const string &arg:request.args) argv.push_back(arg.c_str());
+    argv.push_back(nullptr);
+    char saved_cwd[4096];
+    if(getcwd(saved_cwd,sizeof(saved_cwd))==nullptr) saved_cwd[0]='\0';
+    fflush(stdout);fflush(stderr);
+    int saved_fds[3];
+    for(int fd=0;fd<3;fd++){
+        saved_fds[fd]=dup(fd);
+        dup2(request.fds[fd],fd);
+        close(request.fds[fd]);request.fds[fd]=-1;
+    }
+    resetStdin();
+    int result;
+    if(chdir(request.cwd.c_str())!=0){
+        fprintf(stderr,"Cannot change directory to %s\n",request.cwd.c_str());
+        result=1;
+    } else {
+        const char *filename=argv[0];
+        try{
+            ModuleInfo info=importEntry(filename,request.entry); // 已导入的模块直接使用
+            result=runMain(filename,(ExecutableMain)info.ptr,(int)request.args.size(),argv.data());
+        }catch(const exception &err){
+            fprintf(stderr,"%s\n",err.what());
+            result=1;
+        }
+    }
+    fflush(stdout);fflush(stderr);
+    for(int fd=0;fd<3;fd++){
+        dup2(saved_fds[fd],fd);close(saved_fds[fd]);
+    }
+    resetStdin();
+    if(saved_cwd[0]!='\0' && chdir(saved_cwd)!=0) perror("chdir");
+    quiescentState(); // 请求之间不持有任何函数指针
+    return result;
+}
+void stopServing(int){serve_stopping=1;}
+void childExited(int){} // 只用于中断poll，子进程由reapChildren回收
+bool fork_requests=false; // --fork: 每个请求在fork出的子进程中执行
+vector<string> warm_modules,warm_libraries; // --preload和--preload-lib指定的模块和动态库
+void splitList(const char *list,vector<string> &items){
+    // 按逗号分割选项的值
+    for(const char *start=list;*start!='\0';){
+        const char *end=strchr(start,',');
+        if(end==nullptr) end=start+strlen(start);
+        if(end>start) items.emplace_back(start,end-start);
+        start=(*end==',')?end+1:end;
+    }
+}
+void warmUp(){
+    // 在处理请求之前导入模块、加载动态库，并预先触发模块页面的缺页，fork出的子进程直接继承
+    for(const string &modname:warm_modules){
+        int result=import(modname.c_str());
+        if(result!=IMPORT_SUCCESS)
+            fprintf(stderr,"Warning: cannot preload %s (code %d)\n",modname.c_str(),result);
+        else preloadDependencies(modname.c_str());
+    }
+    for(const string &libname:warm_libraries){
+        if(loadLibrary(libname.c_str())==nullptr)
+            fprintf(stderr,"Warning: cannot load library %s\n",libname.c_str());
+    }
+    lock_guard<recursive_mutex> lock(registry_mutex);
+    for(const auto &[name,info]:imported_funcs) prefaultMemory(info.ptr,info.size);
+    for(const LoadedBundle &bundle:loaded_bundles) prefaultMemory(bundle.info.ptr,bundle.info.size);
+}
+pid_t forkRequest(int sock,int conn,ServeRequest &request){
+    // 在子进程中执行请求，返回子进程的pid，失败时返回-1
+    fflush(stdout);fflush(stderr); // 避免子进程重复输出缓冲区中的内容
+    // 持有这些锁时fork，子进程中不会有被其他线程(如--watch的监视线程)持有的锁
+    registry_mutex.lock();libs_mutex.lock();arena_mutex.lock();
+    pid_t pid=fork();
+    if(pid!=0){
+        arena_mutex.unlock();libs_mutex.unlock();registry_mutex.unlock();
+        return pid;
+    }
+    // 子进程中只有当前线程，线程ID也已改变，因此重新初始化锁而不是解锁
+    new (&registry_mutex) recursive_mutex;new (&libs_mutex) mutex;new (&arena_mutex) mutex;
+    module_watcher=nullptr; // 监视线程没有被复制，不能再调用stop
+    close(sock);close(conn);
+    signal(SIGINT,SIG_DFL);signal(SIGTERM,SIG_DFL);signal(SIGPIPE,SIG_DFL);signal(SIGCHLD,SIG_DFL);
+    forked_child=true; // env->exit仍为serveExit，结束请求后由下面的_exit结束子进程
+    int result=handleRequest(request);
+    fflush(nullptr);
+    _exit(result); // 不执行父进程注册的atexit和静态对象的析构
+}
+int childResult(int status){
+    if(WIFEXITED(status)) return WEXITSTATUS(status);
+    if(WIFSIGNALED(status)) return 128+WTERMSIG(status); // 和shell的约定相同
+    return INT_MAX;
+}
+void reapChildren(unordered_map<pid_t,int> &children,bool block){
+    // 回收已结束的子进程，并将退出码发送给对应的客户端
+    while(!children.empty()){
+        int status;
+        pid_t pid=waitpid(-1,&status,block?0:WNOHANG);
+        if(pid<0 && errno==EINTR) continue;
+        if(pid<=0) return;
+        auto it=children.find(pid);
+        if(it==children.end()) continue;
+        sendResult(it->second,childResult(status));
+        close(it->second);
+        children.erase(it);
+    }
+}
+int serveRequests(const char *socket_path){
+    // 依次处理客户端的请求，已导入的模块和加载的动态库在请求之间保留
+    // --fork时每个请求在子进程中执行，子进程之间互不影响，可以同时运行
+    int sock=listenSocket(socket_path);
+    struct sigaction action;
+    memset(&action,0,sizeof(action));
+    action.sa_handler=stopServing; // 不使用SA_RESTART，使accept被中断
+    sigaction(SIGINT,&action,nullptr);sigaction(SIGTERM,&action,nullptr);
+    signal(SIGPIPE,SIG_IGN); // 客户端提前断开时不结束服务端
+    if(fork_requests){ // 子进程结束时立即返回客户端，不等待poll超时
+        action.sa_handler=childExited;
+        sigaction(SIGCHLD,&action,nullptr);
+    }
+    runtime_env->exit=serveExit;
+    initExecution();
+    warmUp();
+    if(module_watcher!=nullptr) module_watcher->start();
+    fprintf(stderr,"Serving on %s%s\n",socket_path,fork_requests?" (fork per request)":"");
+    unordered_map<pid_t,int> children; // 子进程到客户端的连接
+    while(!serve_stopping){
+        if(fork_requests){
+            reapChildren(children,false);
+            struct pollfd pfd{sock,POLLIN,0};
+            if(poll(&pfd,1,1000)<=0) continue; // 被SIGCHLD中断时回收子进程
+        }
+        int conn=accept4(sock,nullptr,nullptr,SOCK_CLOEXEC);
+        if(conn<0) continue; // 被信号中断，或客户端已断开
+        ServeRequest request;
+        if(receiveRequest(conn,request) && !request.args.empty()){
+            if(!fork_requests) sendResult(conn,handleRequest(request));
+            else{
+                pid_t pid=forkRequest(sock,conn,request);
+                for(int fd:request.fds) close(fd); // 子进程已继承
+                request.fds[0]=request.fds[1]=request.fds[2]=-1;
+                if(pid>0){
+                    children[pid]=conn;
+                    continue;
+                }
+                perror("fork");
+                sendResult(conn,INT_MAX);
+            }
+        }
+        for(int fd:request.fds) if(fd>=0) close(fd);
+        close(conn);
+    }
+    close(sock);unlink(socket_path);
+    reapChildren(children,true); // 等待正在执行的请求
+    runtime_env->exit=std::exit;
+    finishExecution();
+    reclaimer.unregisterThread();
+    return 0;
+}
+int runClient(const char *socket_path,int argc,const char *argv[]){
+    // 将命令行参数和标准输入输出发送给--serve的服务端，返回模块的退出码
+    int sock=connectSocket(socket_path);
+    if(sock<0){
+        fprintf(stderr,"Cannot connect to %s: %s\n",socket_path,strerror(errno));
+        return 1;
+    }
+    ServeRequest request;
+    char cwd[4096];
+    request.cwd=(getcwd(cwd,sizeof(cwd))!=nullptr)?cwd:".";
+    request.entry=entry_func;
+    request.args.assign(argv,argv+argc);
+    for(int fd=0;fd<3;fd++) request.fds[fd]=fd;
+    int32_t result;
+    if(!sendRequest(sock,request) || !receiveResult(sock,result)){
+        fprintf(stderr,"Server on %s closed the connection\n",socket_path);
+        result=1;
+    }
+    close(sock);
+    return result;
+}
+#endif
+
+enum StatsFormat{STATS_NONE=0,STATS_TEXT=1,STATS_JSON=2};
+int stats_format=STATS_NONE; // --stats[=json]
+void printStats(){
+    // 由atexit调用，env->exit结束进程时也会输出
+    fflush(stdout);
+    if(stats_format==STATS_JSON) runtime_stats.printJson(stderr);
+    else runtime_stats.printText(stderr);
+}
+string profile_path; // --profile[=<file>]，为空时不采样
+unsigned int profile_hz=997; // 与其他周期性的计时器错开
+SampleProfiler *profiler=nullptr;
+bool write_perf_map=false; // --perf-map
+bool trace_env=false; // --trace-env
+void reportEnvTrace(){
+    // 由atexit调用，输出每个模块调用最多的env函数
+    fflush(stdout);
+    EnvTracer::active->report(stderr);
+}
+bool track_memory=false; // --mem-track
+unsigned long long default_mem_quota=0; // --mem-quota=<字节数>
+unordered_map<string,unsigned long long> mem_quotas; // --mem-quota=<模块>:<字节数>
+void reportMemory(){
+    fflush(stdout);
+    MemoryAccountant::active->report(stderr);
+}
+bool parseByteSize(const char *str,unsigned long long &bytes){
+    // 解析带可选K、M、G后缀(1024进制)的字节数
+    char *end;
+    bytes=strtoull(str,&end,10);
+    if(end==str) return false;
+    switch(*end){
+        case 'G':case 'g':bytes<<=10; [[fallthrough]];
+        case 'M':case 'm':bytes<<=10; [[fallthrough]];
+        case 'K':case 'k':bytes<<=10;end++;break;
+    }
+    return *end=='\0' && bytes>0;
+}
+bool parseMemQuota(const char *value){
+    const char *sep=strrchr(value,':');
+    if(sep==nullptr) return parseByteSize(value,default_mem_quota);
+    string module(value,sep-value);
+    unsigned long long bytes;
+    if(module.empty() || !parseByteSize(sep+1,bytes)) return false;
+    mem_quotas[module]=bytes;
+    return true;
+}
+string jitdump_dir; // --jitdump[=<目录>]，为空时不生成
+void finishProfile(){
+    // 由atexit调用，写出折叠栈并向stderr输出每个模块的热点偏移量
+    profiler->stop();
+    FILE *file=fopen(profile_path.c_str(),"w");
+    if(file!=nullptr){
+        profiler->writeFolded(file);
+        fclose(file);
+    } else fprintf(stderr,"Warning: cannot write profile to %s\n",profile_path.c_str());
+    fflush(stdout);
+    profiler->writeHistogram(stderr);
+    fprintf(stderr,"Folded stacks written to %s\n",profile_path.c_str());
+}
+bool parseOption(const char *option){
+    // 解析以--开头的命令行选项，未知选项返回false
+    if(strcmp(option,"--mmap")==0)load_mode=LOAD_MMAP;
+    else if(strcmp(option,"--copy")==0)load_mode=LOAD_COPY;
+    else if(strcmp(option,"--prefault")==0)prefault_modules=true;
+    else if(strncmp(option,"--entry=",8)==0)entry_func=option+8;
+    else if(strncmp(option,"--jobs=",7)==0)preload_jobs=strtoul(option+7,nullptr,10);
+    else if(strcmp(option,"--watch")==0)watch_modules=true;
+    else if(strcmp(option,"--no-io-uring")==0)AsyncIO::use_io_uring=false;
+    else if(strncmp(option,"--threads=",10)==0)worker_threads=strtoul(option+10,nullptr,10);
+#ifndef _WIN32
+    else if(strncmp(option,"--serve=",8)==0){
+        serve_socket=option+8;
+        check_module_paths=true; // 在--preload之前设置，预加载的模块也记录路径
+    }
+    else if(strncmp(option,"--client=",9)==0)client_socket=option+9;
+    else if(strcmp(option,"--fork")==0)fork_requests=true;
+    else if(strncmp(option,"--preload=",10)==0)splitList(option+10,warm_modules);
+    else if(strncmp(option,"--preload-lib=",14)==0)splitList(option+14,warm_libraries);
+#endif
+    else if(strcmp(option,"--patch-env-calls")==0)patch_env_calls=true;
+    else if(strcmp(option,"--stats")==0)stats_format=STATS_TEXT;
+    else if(strcmp(option,"--stats=json")==0)stats_format=STATS_JSON;
+    else if(strcmp(option,"--profile")==0)profile_path="profile.folded";
+    else if(strncmp(option,"--profile=",10)==0)profile_path=option+10;
+    else if(strcmp(option,"--perf-map")==0)write_perf_map=true;
+    else if(strcmp(option,"--trace-env")==0)trace_env=true;
+    else if(strcmp(option,"--mem-track")==0)track_memory=true;
+    else if(strncmp(option,"--mem-quota=",12)==0){
+        track_memory=true;
+        if(!parseMemQuota(option+12))return false;
+    }
+    else if(strcmp(option,"--jitdump")==0)jitdump_dir=".";
+    else if(strncmp(option,"--jitdump=",10)==0){
+        jitdump_dir=option+10;
+        if(jitdump_dir.empty())return false;
+    }
+    else if(strncmp(option,"--profile-hz=",13)==0){
+        profile_hz=strtoul(option+13,nullptr,10);
+        if(profile_hz==0)return false;
+    }
+    else if(strcmp(option,"--arena")==0)load_mode=LOAD_ARENA;
+    else if(strncmp(option,"--arena-align=",14)==0){
+        load_mode=LOAD_ARENA;
+        arena_align=strtoul(option+14,nullptr,0);
+        if(arena_align==0 || (arena_align&(arena_align-1))!=0)return false;
+    }
+    else if(strcmp(option,"--hugepages")==0){
+        load_mode=LOAD_ARENA;arena_flags|=ARENA_HUGEPAGES;
+    }
+    else if(strcmp(option,"--mlock")==0){
+        load_mode=LOAD_ARENA;arena_flags|=ARENA_MLOCK;
+    }
+    else return false;
+    return true;
+}
+void printUsage(const char *progname){
+    printf("Usage: %s [options] <%s or %s file> args ...\n",progname,FILEEXT,BUNDLEEXT);
+    printf("Options:\n"
+           "  --mmap      Map module files directly as executable memory (shared, zero-copy)\n"
+           "  --copy      Copy module files into private executable memory (default)\n"
+           "  --prefault  Prefault mapped module pages at load time\n"
+           "  --entry=<func>  Entry function when running a %s bundle (default: first function)\n"
+           "  --jobs=<n>  Threads used to preload declared dependencies (default: CPU count, at most 8)\n"
+           "  --threads=<n>  Worker threads for env->spawn and env->parallelFor (default: CPU count)\n"
+           "  --no-io-uring  Run env->ioSubmit requests on a thread pool instead of io_uring\n"
+           "  --watch     Reload imported modules in the background when their files change\n"
+#ifndef _WIN32
+           "  --serve=<socket>   Keep running and execute requests sent to a Unix socket\n"
+           "  --client=<socket>  Run the module in a --serve process instead of this one\n"
+           "  --fork      With --serve, run each request in a forked copy of the warm server\n"
+           "  --preload=<mod,...>      With --serve, import these modules before serving\n"
+           "  --preload-lib=<lib,...>  With --serve, load these libraries before serving\n"
+#endif
+           "  --patch-env-calls  Rewrite env->func(...) calls in modules into direct calls (x86-64)\n"
+           "  --stats[=json]  Print startup and import phase timings to stderr at exit\n"
+           "  --profile[=<file>]  Sample the process and write folded stacks (default profile.folded)\n"
+           "  --profile-hz=<n>    Samples per second of CPU time for --profile (default 997)\n"
+           "  --trace-env Count and time every env->func(...) call and report the hottest per module\n"
+           "  --mem-track Attribute env heap allocations and open files to modules, report at exit\n"
+           "  --mem-quota=[<module>:]<bytes>  Fail env allocations of a module beyond this (K/M/G)\n"
+           "  --perf-map  Write /tmp/perf-<pid>.map so Linux perf can name module code\n"
+           "  --jitdump[=<dir>]  Also write jit-<pid>.dump with module code for perf inject --jit\n"
+           "  --arena     Pack modules into shared executable pages (bulk released at exit)\n"
+           "  --arena-align=<n>  Alignment of each module in the arena (default 16)\n"
+           "  --hugepages Back the arena with 2 MiB huge pages when available\n"
+           "  --mlock     Lock arena pages in physical memory\n",BUNDLEEXT);
+}
 
 int main(int argc,const char *argv[]) {
+    StatTimer init_timer(runtime_stats,STAT_RUNTIME_INIT);
+    runtime_env=new RuntimeEnv();
     initRuntimeEnv(runtime_env);
+    init_timer.stop();
 
-    if(argc>1){
-        return execExecutable(argv[1],argc-1,argv+1);
+    int i=1;
+    for(;i<argc && strncmp(argv[i],"--",2)==0;i++){
+        if(!parseOption(argv[i])){
+            fprintf(stderr,"Unknown option: %s\n",argv[i]);
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(track_memory){ // 在--trace-env之前替换，转发函数调用记账的版本
+        MemoryAccountant *accountant=new MemoryAccountant(module_index,default_mem_quota);
+        for(const auto &[module,bytes]:mem_quotas) accountant->setQuota(module,bytes);
+        accountant->install(runtime_env);
+        atexit(reportMemory);
+    }
+    if(trace_env){ // 在创建env_call_patcher之前替换，改写后的调用也会经过转发函数
+        EnvTracer::active=new EnvTracer(module_index,ENV_TRACE_NAMES,ENV_TRACE_COUNT);
+        installEnvTrace(runtime_env);
+        atexit(reportEnvTrace);
+    }
+    if(patch_env_calls){
+        if(EnvCallPatcher::supported())
+            env_call_patcher=new EnvCallPatcher(runtime_env,offsetof(RuntimeEnv,getFunc),
+                                                sizeof(RuntimeEnv),allocExecMemoryNear);
+        else fprintf(stderr,"Warning: --patch-env-calls is only supported on x86-64\n");
+    }
+    if(stats_format!=STATS_NONE) atexit(printStats);
+    if(write_perf_map || !jitdump_dir.empty()){
+        if(PerfMapWriter::supported()) perf_map=new PerfMapWriter(write_perf_map,jitdump_dir);
+        else fprintf(stderr,"Warning: --perf-map and --jitdump are only supported on Linux\n");
+    }
+    if(!profile_path.empty()){
+        profiler=new SampleProfiler(module_index);
+        if(profiler->start(profile_hz)) atexit(finishProfile);
+        else fprintf(stderr,"Warning: --profile is only supported on Linux x86/x86-64\n");
+    }
+#ifndef _WIN32
+    if(!serve_socket.empty()){
+        int result=serveRequests(serve_socket.c_str());
+        delete exec_arena;
+        return result;
+    }
+    if(!client_socket.empty() && i<argc)
+        return runClient(client_socket.c_str(),argc-i,argv+i);
+#endif
+    if(i<argc){
+        int result=execExecutable(argv[i],argc-i,argv+i);
+        delete exec_arena; // 统一释放所有LOAD_ARENA方式加载的模块
+        return result;
     }
-    printf("Usage: %s <%s file> args ...\n",argv[0],FILEEXT);
+    printUsage(argv[0]);
     return 0;
 }
\ No newline at end of file
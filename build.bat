@@ -1,4 +1,5 @@
 @echo off
 python runtime_env_generator.py
-g++ bin_runtime.cpp -o bin_runtime -ldbghelp -s -O2 -Wall
-g++ bin_dk.cpp -o bin_dk -s -O2 -Wall & bin_dk
\ No newline at end of file
+g++ bin_runtime.cpp -o bin_runtime -ldbghelp -s -O2 -fno-omit-frame-pointer -Wall
+g++ bench_runtime.cpp -o bench_runtime -ldbghelp -O2 -fno-omit-frame-pointer -Wall
+g++ bin_dk.cpp -o bin_dk -O2 -fno-omit-frame-pointer -Wall & bin_dk
\ No newline at end of file
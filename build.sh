@@ -0,0 +1,7 @@
+#!/bin/sh
+# Linux上的构建脚本，和build.bat相同，另外构建基准测试bench_runtime
+set -e
+python3 runtime_env_generator.py
+g++ bin_runtime.cpp -o bin_runtime -ldl -lpthread -s -O2 -fno-omit-frame-pointer -Wall
+g++ bench_runtime.cpp -o bench_runtime -ldl -lpthread -O2 -fno-omit-frame-pointer -Wall
+g++ bin_dk.cpp -o bin_dk -O2 -fno-omit-frame-pointer -Wall && ./bin_dk
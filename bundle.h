@@ -0,0 +1,143 @@
+// .bnd文件的格式，一个.bnd文件包含多个函数的机器码，以及按函数名哈希的索引
+// 文件布局: BundleHeader | BundleEntry[entry_count] | uint32_t[table_size] | 函数名 | 机器码
+#pragma once
+#include "constants.h"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const char BUNDLE_MAGIC[4]={'B','N','D','L'};
+const uint32_t BUNDLE_VERSION=1;
+const size_t BUNDLE_CODE_ALIGN=16;
+struct BundleHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t table_size; // 哈希表的槽数，为2的幂
+};
+struct BundleEntry{
+    uint64_t name_hash;
+    uint64_t name_offset; // 相对文件开头的偏移量，函数名以'\0'结尾
+    uint64_t code_offset; // 相对文件开头的偏移量，按BUNDLE_CODE_ALIGN对齐
+    uint64_t code_size;
+};
+// 哈希表紧跟在BundleEntry数组之后，每个槽为entry的下标+1，0表示空槽，冲突时线性探测
+
+inline uint64_t bundleHash(const char *name){ // FNV-1a
+    uint64_t hash=0xcbf29ce484222325ULL;
+    for(const unsigned char *p=(const unsigned char *)name;*p;p++){
+        hash^=*p;
+        hash*=0x100000001b3ULL;
+    }
+    return hash;
+}
+inline const BundleEntry *bundleEntries(const void *base){
+    return (const BundleEntry *)((const char *)base+sizeof(BundleHeader));
+}
+inline const uint32_t *bundleTable(const void *base){
+    const BundleHeader *header=(const BundleHeader *)base;
+    return (const uint32_t *)(bundleEntries(base)+header->entry_count);
+}
+inline const char *bundleEntryName(const void *base,const BundleEntry &entry){
+    return (const char *)base+entry.name_offset;
+}
+
+// 检查映射到内存的.bnd文件是否完整，避免越界访问
+inline bool validateBundle(const void *base,size_t size){
+    if(size<sizeof(BundleHeader)) return false;
+    const BundleHeader *header=(const BundleHeader *)base;
+    if(memcmp(header->magic,BUNDLE_MAGIC,sizeof(BUNDLE_MAGIC))!=0 ||
+       header->version!=BUNDLE_VERSION) return false;
+    if(header->table_size==0 || (header->table_size&(header->table_size-1))!=0 ||
+       header->table_size<header->entry_count) return false;
+    size_t index_end=sizeof(BundleHeader)+(size_t)header->entry_count*sizeof(BundleEntry)
+                     +(size_t)header->table_size*sizeof(uint32_t);
+    if(index_end>size) return false;
+    const BundleEntry *entries=bundleEntries(base);
+    for(uint32_t i=0;i<header->entry_count;i++){
+        const BundleEntry &entry=entries[i];
+        if(entry.name_offset>=size || entry.code_offset>size ||
+           entry.code_size>size-entry.code_offset) return false;
+        if(memchr((const char *)base+entry.name_offset,'\0',size-entry.name_offset)==nullptr)
+            return false;
+    }
+    const uint32_t *table=bundleTable(base);
+    for(uint32_t i=0;i<header->table_size;i++)
+        if(table[i]>header->entry_count) return false;
+    return true;
+}
+// 通过哈希表查找函数，未找到时返回nullptr
+inline const BundleEntry *findBundleEntry(const void *base,const char *name){
+    const BundleHeader *header=(const BundleHeader *)base;
+    const BundleEntry *entries=bundleEntries(base);
+    const uint32_t *table=bundleTable(base);
+    uint64_t hash=bundleHash(name);
+    uint32_t mask=header->table_size-1;
+    for(uint32_t i=0;i<header->table_size;i++){
+        uint32_t slot=table[(hash+i)&mask];
+        if(slot==0) return nullptr;
+        const BundleEntry &entry=entries[slot-1];
+        if(entry.name_hash==hash && strcmp(bundleEntryName(base,entry),name)==0)
+            return &entry;
+    }
+    return nullptr;
+}
+
+// 生成.bnd文件，由bin_dk使用
+class BundleWriter {
+public:
+    explicit BundleWriter(const char *name):filename(std::string(name)+BUNDLEEXT) {}
+    void add(const char *name,const void *code,size_t size) {
+        items.push_back(Item{name,std::string((const char *)code,size)});
+    }
+    void save() {
+        uint32_t count=items.size(),table_size=1;
+        while(table_size<count*2) table_size<<=1; // 负载因子不超过0.5
+        std::vector<BundleEntry> entries(count);
+        std::vector<uint32_t> table(table_size,0);
+        size_t offset=sizeof(BundleHeader)+count*sizeof(BundleEntry)+table_size*sizeof(uint32_t);
+        for(uint32_t i=0;i<count;i++){
+            entries[i].name_hash=bundleHash(items[i].name.c_str());
+            entries[i].name_offset=offset;
+            offset+=items[i].name.size()+1;
+            uint32_t pos=entries[i].name_hash&(table_size-1);
+            while(table[pos]!=0) pos=(pos+1)&(table_size-1);
+            table[pos]=i+1;
+        }
+        for(uint32_t i=0;i<count;i++){
+            offset=(offset+BUNDLE_CODE_ALIGN-1)&~(BUNDLE_CODE_ALIGN-1);
+            entries[i].code_offset=offset;
+            entries[i].code_size=items[i].code.size();
+            offset+=items[i].code.size();
+        }
+
+        FILE *file=fopen(filename.c_str(),"wb");
+        if(!file) throw std::runtime_error(strerror(errno));
+        BundleHeader header;
+        memcpy(header.magic,BUNDLE_MAGIC,sizeof(BUNDLE_MAGIC));
+        header.version=BUNDLE_VERSION;
+        header.entry_count=count;
+        header.table_size=table_size;
+        fwrite(&header,sizeof(header),1,file);
+        fwrite(entries.data(),sizeof(BundleEntry),count,file);
+        fwrite(table.data(),sizeof(uint32_t),table_size,file);
+        for(const Item &item:items) fwrite(item.name.c_str(),1,item.name.size()+1,file);
+        for(uint32_t i=0;i<count;i++){
+            long pos=ftell(file);
+            while((size_t)pos<entries[i].code_offset){fputc(0xcc,file);pos++;} // 以int3填充
+            fwrite(items[i].code.data(),1,items[i].code.size(),file);
+        }
+        fclose(file);
+    }
+    std::string filename;
+private:
+    struct Item{
+        std::string name;
+        std::string code;
+    };
+    std::vector<Item> items;
+};
@@ -0,0 +1,261 @@
+// 二进制数据的查找：向量化(SSE2/AVX2，运行时检测)的单模式查找findBytes，以及Aho-Corasick多模式扫描器
+// 用于在机器码、.bnd文件中查找导入槽的标记、特征指令等，不支持SIMD的CPU使用标量版本
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_SCANNER_X86
+#endif
+
+namespace byte_scanner{
+using uchar=unsigned char;
+
+// 候选位置为[0,count)，即查找位置的首字节和末字节都在mem中
+inline const uchar *findBytesScalar(const uchar *mem,size_t count,const uchar *pattern,size_t len){
+    const uchar *end=mem+count;
+    for(const uchar *p=mem;p<end;p++){
+        p=(const uchar *)memchr(p,pattern[0],end-p);
+        if(p==nullptr) return nullptr;
+        if(memcmp(p+1,pattern+1,len-1)==0) return p;
+    }
+    return nullptr;
+}
+#ifdef BYTE_SCANNER_X86
+// 同时比较每个候选位置的首字节和末字节，两者都相等时才比较中间的字节，len>=2
+__attribute__((target("sse2")))
+inline const uchar *findBytesSSE2(const uchar *mem,size_t count,const uchar *pattern,size_t len){
+    const __m128i first=_mm_set1_epi8((char)pattern[0]),last=_mm_set1_epi8((char)pattern[len-1]);
+    size_t i=0;
+    for(;i+16<=count;i+=16){
+        __m128i eq_first=_mm_cmpeq_epi8(first,_mm_loadu_si128((const __m128i *)(mem+i)));
+        __m128i eq_last=_mm_cmpeq_epi8(last,_mm_loadu_si128((const __m128i *)(mem+i+len-1)));
+        unsigned mask=(unsigned)_mm_movemask_epi8(_mm_and_si128(eq_first,eq_last));
+        for(;mask;mask&=mask-1){
+            size_t pos=i+__builtin_ctz(mask);
+            if(memcmp(mem+pos+1,pattern+1,len-2)==0) return mem+pos;
+        }
+    }
+    return findBytesScalar(mem+i,count-i,pattern,len);
+}
+__attribute__((target("avx2")))
+inline const uchar *findBytesAVX2(const uchar *mem,size_t count,const uchar *pattern,size_t len){
+    const __m256i first=_mm256_set1_epi8((char)pattern[0]),last=_mm256_set1_epi8((char)pattern[len-1]);
+    size_t i=0;
+    for(;i+32<=count;i+=32){
+        __m256i eq_first=_mm256_cmpeq_epi8(first,_mm256_loadu_si256((const __m256i *)(mem+i)));
+        __m256i eq_last=_mm256_cmpeq_epi8(last,_mm256_loadu_si256((const __m256i *)(mem+i+len-1)));
+        unsigned mask=(unsigned)_mm256_movemask_epi8(_mm256_and_si256(eq_first,eq_last));
+        for(;mask;mask&=mask-1){
+            size_t pos=i+__builtin_ctz(mask);
+            if(memcmp(mem+pos+1,pattern+1,len-2)==0) return mem+pos;
+        }
+    }
+    return findBytesScalar(mem+i,count-i,pattern,len);
+}
+
+// 查找第一个等于bytes中任意一个(1到4个)的字节，end为nullptr时不限长度(和memchr一样须保证能找到)
+// 向量部分只使用对齐的读取，不会越过页面边界，因此可以读取到找到的字节或end之后
+inline bool anyByteAt(const uchar *p,const uchar *bytes,int count){
+    for(int i=0;i<count;i++)
+        if(*p==bytes[i]) return true;
+    return false;
+}
+__attribute__((target("sse2")))
+inline const uchar *findAnyByteSSE2(const uchar *p,const uchar *end,const uchar *bytes,int count){
+    if(p==end) return nullptr;
+    __m128i targets[4];
+    for(int i=0;i<4;i++) targets[i]=_mm_set1_epi8((char)bytes[i<count?i:0]);
+    auto matchMask=[&](const uchar *block_ptr) __attribute__((target("sse2"))) {
+        __m128i block=_mm_load_si128((const __m128i *)block_ptr);
+        __m128i eq=_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block,targets[0]),_mm_cmpeq_epi8(block,targets[1])),
+                                _mm_or_si128(_mm_cmpeq_epi8(block,targets[2]),_mm_cmpeq_epi8(block,targets[3])));
+        return (unsigned)_mm_movemask_epi8(eq);
+    };
+    // 第一个块从p所在的对齐位置读取，忽略p之前的字节
+    const uchar *base=(const uchar *)((size_t)p&~(size_t)15);
+    unsigned mask=matchMask(base)&(0xffffu<<(p-base));
+    if(mask){
+        const uchar *found=base+__builtin_ctz(mask);
+        return (end!=nullptr && found>=end)?nullptr:found;
+    }
+    for(p=base+16;end==nullptr || p+16<=end;p+=16){
+        mask=matchMask(p);
+        if(mask) return p+__builtin_ctz(mask);
+    }
+    for(;p<end;p++)
+        if(anyByteAt(p,bytes,count)) return p;
+    return nullptr;
+}
+__attribute__((target("avx2")))
+inline const uchar *findAnyByteAVX2(const uchar *p,const uchar *end,const uchar *bytes,int count){
+    if(p==end) return nullptr;
+    __m256i targets[4];
+    for(int i=0;i<4;i++) targets[i]=_mm256_set1_epi8((char)bytes[i<count?i:0]);
+    auto matchMask=[&](const uchar *block_ptr) __attribute__((target("avx2"))) {
+        __m256i block=_mm256_load_si256((const __m256i *)block_ptr);
+        __m256i eq=_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block,targets[0]),_mm256_cmpeq_epi8(block,targets[1])),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block,targets[2]),_mm256_cmpeq_epi8(block,targets[3])));
+        return (unsigned)_mm256_movemask_epi8(eq);
+    };
+    const uchar *base=(const uchar *)((size_t)p&~(size_t)31);
+    unsigned mask=matchMask(base)&(0xffffffffu<<(p-base));
+    if(mask){
+        const uchar *found=base+__builtin_ctz(mask);
+        return (end!=nullptr && found>=end)?nullptr:found;
+    }
+    for(p=base+32;end==nullptr || p+32<=end;p+=32){
+        mask=matchMask(p);
+        if(mask) return p+__builtin_ctz(mask);
+    }
+    for(;p<end;p++)
+        if(anyByteAt(p,bytes,count)) return p;
+    return nullptr;
+}
+#endif
+
+enum SimdLevel{SIMD_NONE=0,SIMD_SSE2=1,SIMD_AVX2=2};
+inline int simdLevel(){
+    // 第一次调用时检测，之后的调用只读取静态变量
+#ifdef BYTE_SCANNER_X86
+    static const int level=__builtin_cpu_supports("avx2")?SIMD_AVX2:
+                           __builtin_cpu_supports("sse2")?SIMD_SSE2:SIMD_NONE;
+    return level;
+#else
+    return SIMD_NONE;
+#endif
+}
+inline const uchar *findAnyByte(const uchar *p,const uchar *end,const uchar *bytes,int count){
+#ifdef BYTE_SCANNER_X86
+    switch(simdLevel()){
+        case SIMD_AVX2:return findAnyByteAVX2(p,end,bytes,count);
+        case SIMD_SSE2:return findAnyByteSSE2(p,end,bytes,count);
+    }
+#endif
+    for(;p!=end;p++)
+        if(anyByteAt(p,bytes,count)) return p;
+    return nullptr;
+}
+} // namespace byte_scanner
+
+// 在mem中查找pattern第一次出现的位置，和memmem相同，未找到时返回nullptr
+inline void *findBytes(const void *mem,size_t size,const void *pattern,size_t len){
+    using byte_scanner::uchar;
+    if(len==0) return const_cast<void *>(mem);
+    if(len>size) return nullptr;
+    const uchar *data=(const uchar *)mem,*pat=(const uchar *)pattern;
+    if(len==1) return const_cast<void *>(memchr(mem,pat[0],size)); // libc的memchr已经向量化
+    size_t count=size-len+1; // 候选位置的个数
+    const uchar *found;
+    switch(byte_scanner::simdLevel()){
+#ifdef BYTE_SCANNER_X86
+        case byte_scanner::SIMD_AVX2:found=byte_scanner::findBytesAVX2(data,count,pat,len);break;
+        case byte_scanner::SIMD_SSE2:found=byte_scanner::findBytesSSE2(data,count,pat,len);break;
+#endif
+        default:found=byte_scanner::findBytesScalar(data,count,pat,len);
+    }
+    return const_cast<uchar *>(found);
+}
+
+// 同时查找多个模式的Aho-Corasick扫描器，用add添加所有模式、build生成状态转移表之后调用scan
+// 扫描每个字节只查一次表，与模式的个数无关；不在任何部分匹配中时，用SIMD跳到下一个可能的模式首字节
+class MultiPatternScanner {
+public:
+    // 添加模式，id在匹配时原样返回，忽略空的模式
+    void add(const void *pattern,size_t len,int id) {
+        if(len==0) return;
+        patterns.push_back(Pattern{std::string((const char *)pattern,len),id});
+        built=false;
+    }
+    size_t patternCount() const {return patterns.size();}
+
+    void build() {
+        const uint32_t NONE=UINT32_MAX;
+        next.assign(256,NONE);
+        outputs.assign(1,{});
+        for(size_t index=0;index<patterns.size();index++){
+            uint32_t state=0;
+            for(unsigned char c:patterns[index].bytes){
+                if(next[state*256+c]==NONE){
+                    next[state*256+c]=(uint32_t)outputs.size();
+                    outputs.emplace_back();
+                    next.resize(next.size()+256,NONE);
+                }
+                state=next[state*256+c];
+            }
+            outputs[state].push_back(index);
+        }
+        // 按广度优先的顺序计算失败转移，并直接填入转移表，扫描时不需要回溯
+        std::vector<uint32_t> fail(outputs.size(),0);
+        std::deque<uint32_t> queue;
+        start_count=0;
+        bool many_starts=false;
+        for(int c=0;c<256;c++){
+            uint32_t child=next[c];
+            if(child==NONE) next[c]=0;
+            else{
+                queue.push_back(child);
+                if(start_count<4) start_bytes[start_count++]=(unsigned char)c;
+                else many_starts=true;
+            }
+        }
+        if(many_starts) start_count=0; // 首字节超过4种时不跳过
+        while(!queue.empty()){
+            uint32_t state=queue.front();queue.pop_front();
+            const std::vector<size_t> &inherited=outputs[fail[state]];
+            outputs[state].insert(outputs[state].end(),inherited.begin(),inherited.end());
+            for(int c=0;c<256;c++){
+                uint32_t &child=next[state*256+c];
+                if(child==NONE) child=next[fail[state]*256+c];
+                else{
+                    fail[child]=next[fail[state]*256+c];
+                    queue.push_back(child);
+                }
+            }
+        }
+        accepting.assign(outputs.size(),0);
+        for(size_t state=0;state<outputs.size();state++) accepting[state]=!outputs[state].empty();
+        built=true;
+    }
+
+    // 按匹配结束位置的顺序对每个匹配调用func(id,匹配开始的偏移量)，func返回false时停止
+    // 返回报告的匹配数，size为SIZE_MAX时一直扫描到func返回false(用于长度未知的机器码)
+    template<typename Func>
+    size_t scan(const void *mem,size_t size,Func func) const {
+        if(!built || patterns.empty()) return 0;
+        const unsigned char *begin=(const unsigned char *)mem,*p=begin;
+        const unsigned char *end=(size==SIZE_MAX)?nullptr:begin+size;
+        uint32_t state=0;size_t matches=0;
+        while(p!=end){
+            if(state==0 && start_count>0){ // 跳过不可能开始匹配的字节
+                p=byte_scanner::findAnyByte(p,end,start_bytes,start_count);
+                if(p==nullptr) break;
+            }
+            state=next[state*256+*p++];
+            if(!accepting[state]) continue;
+            for(size_t index:outputs[state]){
+                matches++;
+                const Pattern &pattern=patterns[index];
+                if(!func(pattern.id,(size_t)(p-begin)-pattern.bytes.size())) return matches;
+            }
+        }
+        return matches;
+    }
+private:
+    struct Pattern{
+        std::string bytes;
+        int id;
+    };
+    std::vector<Pattern> patterns;
+    std::vector<uint32_t> next; // 状态*256+字节 -> 下一个状态，状态0为初始状态
+    std::vector<std::vector<size_t>> outputs; // 每个状态结束的模式，包括经失败转移可达的
+    std::vector<char> accepting;
+    unsigned char start_bytes[4]; // 模式的首字节，不超过4种时用于跳过
+    int start_count=0;
+    bool built=false;
+};
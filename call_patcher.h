@@ -0,0 +1,158 @@
+// 加载时将模块中通过RuntimeEnv的间接调用改写为直接调用(仅x86-64)
+// call [reg+disp32](6或7字节)被改写为call rel32到附近的跳板，跳板先确认reg确实指向RuntimeEnv，
+// 再直接跳转到加载时解析的函数地址；reg不是RuntimeEnv时执行原来的间接跳转，因此误识别不影响正确性
+#pragma once
+#include "x86_decoder.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class EnvCallPatcher {
+public:
+    using AllocNear=void *(*)(const void *addr,size_t size,size_t range); // 如allocExecMemoryNear
+    static const size_t PAGE_SIZE=64*1024; // 每次申请的跳板内存
+    static const size_t TRAMPOLINE_SIZE=48;
+
+    // env中[first_offset,env_size)范围内的成员都是函数指针
+    EnvCallPatcher(const void *env,size_t first_offset,size_t env_size,AllocNear alloc_near)
+        :env((const uint8_t *)env),first_offset(first_offset),env_size(env_size),alloc_near(alloc_near) {}
+    EnvCallPatcher(const EnvCallPatcher &)=delete;
+    EnvCallPatcher &operator=(const EnvCallPatcher &)=delete;
+
+    static bool supported() {
+#if defined(__x86_64__) || defined(_M_X64)
+        return true;
+#else
+        return false;
+#endif
+    }
+    // 从入口开始沿所有分支解码code，改写其中的调用，返回改写的个数；code须可写，且没有线程正在执行
+    size_t patch(void *code,size_t size) {
+        if(!supported()) return 0;
+        std::vector<size_t> sites;
+        findSites((uint8_t *)code,size,sites);
+        size_t count=0;
+        for(size_t offset:sites){
+            if(patchSite((uint8_t *)code+offset,size-offset)) count++;
+        }
+        patched_count+=count;
+        return count;
+    }
+    size_t patchedCount() const {return patched_count;}
+    size_t trampolineCount() const {return trampoline_count;}
+private:
+    struct Page{
+        uint8_t *base;
+        size_t used;
+        std::unordered_map<uint64_t,uint8_t *> trampolines; // (寄存器,偏移量)到跳板，同一页中共用
+    };
+    // 是否为可改写的call [reg+disp32]，reg不能是rsp/r12(需要SIB)和r11(跳板使用)
+    bool isEnvCall(const X86Instruction &ins,int &reg) const {
+        if(ins.opcode_map!=0 || ins.opcode!=0xff || !ins.has_modrm || ins.has_sib) return false;
+        uint8_t mod=ins.modrm>>6,op=(ins.modrm>>3)&7,rm=ins.modrm&7;
+        if(op!=2 || mod!=2 || ins.disp_size!=4) return false;
+        if(ins.length!=(ins.rex?7u:6u)) return false; // 除REX外没有其他前缀
+        if(ins.rex&0x08) return false; // REX.W对call无意义，不处理
+        reg=rm|((ins.rex&1)?8:0);
+        if(reg==11) return false;
+        return ins.disp>=(long long)first_offset && ins.disp%sizeof(void *)==0 &&
+               (size_t)ins.disp+sizeof(void *)<=env_size;
+    }
+    void findSites(const uint8_t *code,size_t size,std::vector<size_t> &sites) const {
+        // 只解码从入口可达的指令，不会把导入槽等数据当作指令
+        std::vector<size_t> worklist{0};
+        std::unordered_set<size_t> visited;
+        X86Instruction ins;
+        while(!worklist.empty()){
+            size_t offset=worklist.back();worklist.pop_back();
+            while(offset<size && visited.insert(offset).second){
+                if(decodeX86(code+offset,size-offset,&ins)==0) break;
+                int reg;
+                if(ins.flow==FLOW_CALL_INDIRECT && isEnvCall(ins,reg)) sites.push_back(offset);
+                long long target=(long long)offset+ins.target;
+                bool in_range=target>=0 && (size_t)target<size;
+                if((ins.flow==FLOW_JCC || ins.flow==FLOW_JMP || ins.flow==FLOW_CALL) && in_range)
+                    worklist.push_back(target);
+                if(ins.flow==FLOW_JMP || ins.flow==FLOW_RET || ins.flow==FLOW_STOP ||
+                   ins.flow==FLOW_JMP_INDIRECT) break;
+                offset+=ins.length;
+            }
+        }
+    }
+    bool patchSite(uint8_t *site,size_t maxlen) {
+        X86Instruction ins;int reg;
+        if(decodeX86(site,maxlen,&ins)==0 || !isEnvCall(ins,reg)) return false;
+        void *target;
+        memcpy(&target,env+ins.disp,sizeof(void *));
+        if(target==nullptr) return false;
+        uint8_t *trampoline=getTrampoline(site,ins,reg,target);
+        if(trampoline==nullptr) return false;
+        int32_t rel=(int32_t)((long long)(size_t)trampoline-(long long)(size_t)(site+5));
+        uint8_t patched[7]={0xe8,0,0,0,0,0x66,0x90}; // 多余的字节用nop填充
+        memcpy(patched+1,&rel,4);
+        if(ins.length==6) patched[5]=0x90;
+        memcpy(site,patched,ins.length);
+        return true;
+    }
+    static bool fitsRel32(const void *from,const void *to) {
+        long long distance=(long long)(size_t)to-(long long)(size_t)from;
+        return distance>=INT32_MIN && distance<=INT32_MAX;
+    }
+    uint8_t *getTrampoline(uint8_t *site,const X86Instruction &ins,int reg,void *target) {
+        uint64_t key=((uint64_t)reg<<32)|(uint32_t)ins.disp;
+        Page *page=nullptr;
+        for(Page &candidate:pages){
+            if(!fitsRel32(site,candidate.base) || !fitsRel32(site,candidate.base+PAGE_SIZE)) continue;
+            auto it=candidate.trampolines.find(key);
+            if(it!=candidate.trampolines.end()) return it->second;
+            if(candidate.used+TRAMPOLINE_SIZE<=PAGE_SIZE){page=&candidate;break;}
+        }
+        if(page==nullptr){
+            uint8_t *base=(uint8_t *)alloc_near(site,PAGE_SIZE,(size_t)1<<30); // 留出余量，之后的模块也可能使用
+            if(base==nullptr) return nullptr;
+            pages.push_back(Page{base,0,{}});
+            page=&pages.back();
+        }
+        uint8_t *trampoline=page->base+page->used;
+        emitTrampoline(trampoline,ins,reg,target);
+        page->used+=TRAMPOLINE_SIZE;
+        page->trampolines[key]=trampoline;
+        trampoline_count++;
+        return trampoline;
+    }
+    void emitTrampoline(uint8_t *out,const X86Instruction &ins,int reg,void *target) const {
+        uint8_t *p=out;
+        *p++=0x49;*p++=0xbb;memcpy(p,&env,8);p+=8; // movabs r11,env
+        *p++=0x4c|(reg>=8?1:0);*p++=0x39;*p++=0xc0|(3<<3)|(reg&7); // cmp reg,r11
+        uint8_t *jne=p;*p++=0x75;*p++=0; // jne slow
+        const uint8_t *fast=p;
+        if(fitsRel32(p+5,target)){ // jmp rel32
+            int32_t rel=(int32_t)((long long)(size_t)target-(long long)(size_t)(p+5));
+            *p++=0xe9;memcpy(p,&rel,4);p+=4;
+        } else { // movabs r11,target; jmp r11
+            *p++=0x49;*p++=0xbb;memcpy(p,&target,8);p+=8;
+            *p++=0x41;*p++=0xff;*p++=0xe3;
+        }
+        jne[1]=(uint8_t)(p-fast);
+        p=emitOriginalAsJmp(p,ins); // slow: 返回地址已由call rel32压栈
+        while(p<out+TRAMPOLINE_SIZE) *p++=0xcc;
+    }
+    static uint8_t *emitOriginalAsJmp(uint8_t *p,const X86Instruction &ins) {
+        // 原指令改为jmp [reg+disp32]
+        if(ins.rex) *p++=ins.rex;
+        *p++=0xff;
+        *p++=(ins.modrm&~0x38)|(4<<3); // /2(call)改为/4(jmp)
+        int32_t disp=(int32_t)ins.disp;
+        memcpy(p,&disp,4);
+        return p+4;
+    }
+
+    const uint8_t *env;
+    size_t first_offset,env_size;
+    AllocNear alloc_near;
+    std::vector<Page> pages;
+    size_t patched_count=0,trampoline_count=0;
+};
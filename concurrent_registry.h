@@ -0,0 +1,177 @@
+// 读多写少的并发容器，读取不加锁，写入由内部的互斥锁串行化
+// 元素只增不删，扩容后旧的表保留到容器析构，因此读取者不需要延迟释放
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 字符串到T的开放寻址哈希表，T须为可原子读写的类型(如int或指针)
+template<typename T>
+class ConcurrentMap {
+public:
+    explicit ConcurrentMap(size_t capacity=64) {
+        size_t size=16;
+        while(size<capacity) size<<=1;
+        current.store(new Table(size),std::memory_order_release);
+    }
+    ~ConcurrentMap() {
+        delete current.load();
+        for(Table *table:retired) delete table;
+    }
+    ConcurrentMap(const ConcurrentMap &)=delete;
+    ConcurrentMap &operator=(const ConcurrentMap &)=delete;
+
+    // 不加锁，可与insert并发调用
+    bool find(std::string_view key,T &value) const {
+        const Table *table=current.load(std::memory_order_acquire);
+        uint64_t hash=hashKey(key);
+        for(size_t i=0;i<table->size;i++){
+            const Slot &slot=table->slots[(hash+i)&(table->size-1)];
+            uint64_t slot_hash=slot.hash.load(std::memory_order_acquire);
+            if(slot_hash==0) return false;
+            if(slot_hash==hash && slot.key.size()==key.size() &&
+               memcmp(slot.key.data(),key.data(),key.size())==0){
+                value=slot.value.load(std::memory_order_acquire);
+                return true;
+            }
+        }
+        return false;
+    }
+    // 插入或更新，已存在时只更新值
+    void insert(std::string_view key,T value) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        Table *table=current.load(std::memory_order_relaxed);
+        uint64_t hash=hashKey(key);
+        Slot *slot=findSlot(table,key,hash);
+        if(slot->hash.load(std::memory_order_relaxed)!=0){
+            slot->value.store(value,std::memory_order_release);
+            return;
+        }
+        if((count+1)*2>table->size){ // 负载因子不超过0.5
+            table=grow(table);
+            slot=findSlot(table,key,hash);
+        }
+        slot->key=keys.emplace_back(key);
+        slot->value.store(value,std::memory_order_relaxed);
+        slot->hash.store(hash,std::memory_order_release); // 最后发布，读取者看到hash时key和value已写入
+        count++;
+    }
+    // 遍历所有元素，遍历期间插入的元素可能不会被访问到
+    template<typename Func>
+    void forEach(Func func) const {
+        const Table *table=current.load(std::memory_order_acquire);
+        for(size_t i=0;i<table->size;i++){
+            const Slot &slot=table->slots[i];
+            if(slot.hash.load(std::memory_order_acquire)!=0)
+                func(slot.key,slot.value.load(std::memory_order_acquire));
+        }
+    }
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        return count;
+    }
+private:
+    struct Slot{
+        std::atomic<uint64_t> hash{0}; // 0表示空槽
+        std::string_view key; // 指向keys中的字符串
+        std::atomic<T> value{};
+    };
+    struct Table{
+        explicit Table(size_t size):size(size),slots(new Slot[size]) {}
+        ~Table() {delete[] slots;}
+        size_t size;
+        Slot *slots;
+    };
+    static uint64_t hashKey(std::string_view key) { // FNV-1a
+        uint64_t hash=0xcbf29ce484222325ULL;
+        for(unsigned char c:key){
+            hash^=c;
+            hash*=0x100000001b3ULL;
+        }
+        return hash?hash:1;
+    }
+    static Slot *findSlot(Table *table,std::string_view key,uint64_t hash) {
+        // 返回key所在的槽，不存在时返回应插入的空槽
+        for(size_t i=0;;i++){
+            Slot &slot=table->slots[(hash+i)&(table->size-1)];
+            uint64_t slot_hash=slot.hash.load(std::memory_order_relaxed);
+            if(slot_hash==0 || (slot_hash==hash && slot.key==key)) return &slot;
+        }
+    }
+    Table *grow(Table *old) {
+        Table *table=new Table(old->size*2);
+        for(size_t i=0;i<old->size;i++){
+            Slot &slot=old->slots[i];
+            uint64_t hash=slot.hash.load(std::memory_order_relaxed);
+            if(hash==0) continue;
+            Slot *target=findSlot(table,slot.key,hash);
+            target->key=slot.key;
+            target->value.store(slot.value.load(std::memory_order_relaxed),std::memory_order_relaxed);
+            target->hash.store(hash,std::memory_order_relaxed);
+        }
+        current.store(table,std::memory_order_release);
+        retired.push_back(old); // 读取者可能仍在访问旧表
+        return table;
+    }
+
+    std::atomic<Table *> current;
+    std::vector<Table *> retired;
+    std::deque<std::string> keys; // deque扩容时不会移动已有的元素
+    size_t count=0;
+    mutable std::mutex write_mutex;
+};
+
+// 只增不删的数组，元素的地址不会改变，按下标读取不加锁
+template<typename T>
+class AppendOnlyTable {
+public:
+    AppendOnlyTable() {
+        for(auto &segment:segments) segment.store(nullptr,std::memory_order_relaxed);
+    }
+    ~AppendOnlyTable() {
+        for(auto &segment:segments) delete[] segment.load();
+    }
+    AppendOnlyTable(const AppendOnlyTable &)=delete;
+    AppendOnlyTable &operator=(const AppendOnlyTable &)=delete;
+
+    // 返回新元素的下标
+    size_t push_back(const T &value) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        size_t index=count.load(std::memory_order_relaxed);
+        size_t segment,offset;
+        locate(index,segment,offset);
+        T *data=segments[segment].load(std::memory_order_relaxed);
+        if(data==nullptr){
+            data=new T[FIRST_SEGMENT<<segment]();
+            segments[segment].store(data,std::memory_order_release);
+        }
+        data[offset]=value;
+        count.store(index+1,std::memory_order_release);
+        return index;
+    }
+    // 下标越界时返回nullptr
+    T *at(size_t index) const {
+        if(index>=count.load(std::memory_order_acquire)) return nullptr;
+        size_t segment,offset;
+        locate(index,segment,offset);
+        return &segments[segment].load(std::memory_order_acquire)[offset];
+    }
+    T &operator[](size_t index) const {return *at(index);}
+    size_t size() const {return count.load(std::memory_order_acquire);}
+private:
+    static const size_t FIRST_SEGMENT=16; // 第k段的大小为FIRST_SEGMENT<<k
+    static void locate(size_t index,size_t &segment,size_t &offset) {
+        size_t pos=index/FIRST_SEGMENT+1;
+        segment=63-__builtin_clzll((unsigned long long)pos);
+        offset=index-FIRST_SEGMENT*((size_t(1)<<segment)-1);
+    }
+    std::atomic<T *> segments[sizeof(size_t)*8-4];
+    std::atomic<size_t> count{0};
+    std::mutex write_mutex;
+};
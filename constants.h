@@ -2,6 +2,10 @@
 #pragma once
 const size_t MEMORY_STEP=512; // 查找的内存地址间隔
 const char *FILEEXT=".bin";
+const char *DEPSEXT=".deps"; // 模块依赖声明文件的扩展名
+const char *BUNDLEEXT=".bnd"; // 包含多个函数的模块文件的扩展名
+// 导入槽的标记，导入槽的格式: 标记 | 函数地址(指针大小) | 模块名\0 | 函数名\0
+#define IMPORT_SLOT_MAGIC "BINIMP01"
 struct RuntimeVersion{
     unsigned short major;
     unsigned short minor;
@@ -13,6 +17,7 @@ const unsigned short RUNTIME_VERSION_REVISION=0;
 enum ImportResult{
     INVALID_ARGUMENT=-1,
     MODULE_NOT_FOUND=1,
+    INVALID_MODULE=2,
     UNKNOWN_ERROR=3,
     IMPORT_SUCCESS=0,
 };
@@ -20,4 +25,70 @@ enum Platforms{
     WIN32_=1,
     POSIX=2,
     UNKNOWN=0,
-};
\ No newline at end of file
+};
+enum LoadMode{
+    LOAD_COPY=0, // 读取文件并复制到新申请的可执行内存
+    LOAD_MMAP=1, // 直接将文件映射为只读、可执行的内存，多个进程共享物理页
+    LOAD_ARENA=2, // 复制到ExecArena中，多个模块共用页面，随ExecArena统一释放
+    LOAD_BUNDLE=3, // 位于已加载的.bnd文件中，随.bnd文件释放
+};
+struct ModuleInfo{
+    void *ptr; // 模块代码的地址
+    size_t size;
+    int loadmode; // 模块的加载方式，为LoadMode的值
+    int handle; // 模块的句柄，重新加载后不变
+};
+const int INVALID_HANDLE=-1;
+enum IoOpcode{
+    IO_READ=0,
+    IO_WRITE=1,
+};
+struct IoRequest{ // env->ioSubmit提交的异步读写请求
+    int opcode; // IoOpcode的值
+    int fd;
+    void *buf;
+    size_t size;
+    long long offset; // 文件中的偏移量，-1表示使用并更新文件的当前位置
+    void *user_data; // 原样返回到IoCompletion中，用于区分请求
+};
+struct IoCompletion{
+    void *user_data;
+    long long result; // 传输的字节数，失败时为-errno
+};
+enum StatPhase{ // 启动和导入各阶段的计时，用于--stats和env->getStats
+    STAT_RUNTIME_INIT=0, // 创建并填充RuntimeEnv
+    STAT_IMPORT=1, // import的总耗时，包括递归导入的模块，不包括以相同参数再次导入的快速路径
+    STAT_RESOLVE_PATH=2, // 由import的参数得到路径，并查找已导入的模块
+    STAT_FILE_OPEN=3, // 打开文件并获取大小
+    STAT_EXEC_ALLOC=4, // 申请可执行内存
+    STAT_FILE_COPY=5, // 将文件读入可执行内存
+    STAT_FILE_MAP=6, // --mmap时映射文件
+    STAT_LINK=7, // 改写env调用并填入导入槽
+    STAT_LOAD_LIBRARY=8, // dlopen/LoadLibrary
+    STAT_GET_SYMBOL=9, // dlsym/GetProcAddress
+    STAT_PHASE_COUNT=10,
+};
+struct PhaseStats{
+    unsigned long long count;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+};
+struct RuntimeStats{ // env->getStats的结果，之后新增的成员放在末尾
+    PhaseStats phases[STAT_PHASE_COUNT];
+    unsigned long long modules_loaded; // 读取或映射的模块文件数，包括.bnd文件
+    unsigned long long bytes_mapped; // 为模块申请或映射的内存字节数
+    unsigned long long libraries_loaded;
+};
+enum HeapArenaFlags{ // env->arenaCreate的flags
+    ARENA_MODULE=1, // 属于调用arenaCreate的模块，模块被卸载或替换后释放时一并释放
+};
+struct ModuleMemoryStats{ // env->getModuleMemory的结果，之后新增的成员放在末尾
+    unsigned long long live_bytes; // 通过env->malloc等申请且尚未释放的字节数
+    unsigned long long peak_bytes;
+    unsigned long long allocations; // 成功分配的次数
+    unsigned long long open_files; // 通过env->fopen打开且尚未关闭的文件数
+    unsigned long long peak_open_files;
+    unsigned long long quota_bytes; // 0表示不限制
+    unsigned long long denied; // 因超出上限而失败的分配次数
+    unsigned long long arena_bytes; // live_bytes中env->arenaCreate创建的分配器申请的块
+};
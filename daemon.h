@@ -0,0 +1,165 @@
+// --serve守护进程模式的通信协议：客户端通过Unix套接字发送工作目录、入口函数和命令行参数，
+// 并用SCM_RIGHTS传递自己的标准输入、输出和错误，服务端在同一进程中执行后返回退出码
+// 请求的格式: 头部(SERVE_MAGIC | 字符串个数 | 字符串总长度，附带3个文件描述符) | 工作目录\0 | 入口函数\0 | 参数\0 ...
+// 回复的格式: 退出码(int32)
+#pragma once
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const uint32_t SERVE_MAGIC=0x31515242; // "BRQ1"
+const size_t SERVE_MAX_REQUEST=1<<20; // 请求中字符串的最大总长度
+
+struct ServeRequest{
+    std::string cwd; // 客户端的工作目录，相对路径的模块在其中查找
+    std::string entry; // 运行.bnd文件时的入口函数，为空时使用第一个函数
+    std::vector<std::string> args; // 第0项是模块文件名
+    int fds[3]={-1,-1,-1}; // 客户端的标准输入、输出和错误
+};
+
+namespace _daemon_h{
+using namespace std;
+
+struct RequestHeader{
+    uint32_t magic;
+    uint32_t count;
+    uint32_t length;
+};
+inline bool writeFull(int fd,const void *data,size_t size){
+    const char *p=(const char *)data;
+    while(size>0){
+        ssize_t written=write(fd,p,size);
+        if(written<0 && errno==EINTR) continue;
+        if(written<=0) return false;
+        p+=written;size-=written;
+    }
+    return true;
+}
+inline bool readFull(int fd,void *data,size_t size){
+    char *p=(char *)data;
+    while(size>0){
+        ssize_t count=read(fd,p,size);
+        if(count<0 && errno==EINTR) continue;
+        if(count<=0) return false;
+        p+=count;size-=count;
+    }
+    return true;
+}
+inline bool makeAddress(const char *path,sockaddr_un &addr){
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family=AF_UNIX;
+    if(strlen(path)>=sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path,path);
+    return true;
+}
+// 连接到服务端，失败时返回-1
+inline int connectSocket(const char *path){
+    sockaddr_un addr;
+    if(!makeAddress(path,addr)) return -1;
+    int sock=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+    if(sock<0) return -1;
+    if(connect(sock,(sockaddr *)&addr,sizeof(addr))!=0){
+        close(sock);return -1;
+    }
+    return sock;
+}
+// 创建监听的套接字，失败或已有服务端在运行时抛出runtime_error
+inline int listenSocket(const char *path){
+    sockaddr_un addr;
+    if(!makeAddress(path,addr)) throw runtime_error(string("Socket path too long: ")+path);
+    int probe=connectSocket(path);
+    if(probe>=0){
+        close(probe);
+        throw runtime_error(string("Another server is listening on ")+path);
+    }
+    unlink(path); // 删除上次异常退出时残留的套接字文件
+    int sock=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+    if(sock<0) throw runtime_error("socket() failed");
+    if(bind(sock,(sockaddr *)&addr,sizeof(addr))!=0 || listen(sock,64)!=0){
+        close(sock);
+        throw runtime_error(string("Cannot listen on ")+path+": "+strerror(errno));
+    }
+    return sock;
+}
+
+inline bool sendRequest(int sock,const ServeRequest &request){
+    string payload;
+    payload.append(request.cwd).push_back('\0');
+    payload.append(request.entry).push_back('\0');
+    for(const string &arg:request.args) payload.append(arg).push_back('\0');
+    RequestHeader header{SERVE_MAGIC,(uint32_t)request.args.size()+2,(uint32_t)payload.size()};
+    // 文件描述符随头部一起发送，之后的字符串可能分多次读取
+    iovec iov{&header,sizeof(header)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(request.fds))];
+    msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov=&iov;msg.msg_iovlen=1;
+    msg.msg_control=control;msg.msg_controllen=sizeof(control);
+    cmsghdr *cmsg=CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level=SOL_SOCKET;cmsg->cmsg_type=SCM_RIGHTS;
+    cmsg->cmsg_len=CMSG_LEN(sizeof(request.fds));
+    memcpy(CMSG_DATA(cmsg),request.fds,sizeof(request.fds));
+    ssize_t sent;
+    do sent=sendmsg(sock,&msg,MSG_NOSIGNAL);
+    while(sent<0 && errno==EINTR);
+    if(sent!=(ssize_t)sizeof(header)) return false;
+    return writeFull(sock,payload.data(),payload.size());
+}
+// 成功时request.fds为收到的文件描述符，由调用者关闭
+inline bool receiveRequest(int sock,ServeRequest &request){
+    RequestHeader header;
+    iovec iov{&header,sizeof(header)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(request.fds))];
+    msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov=&iov;msg.msg_iovlen=1;
+    msg.msg_control=control;msg.msg_controllen=sizeof(control);
+    ssize_t received;
+    do received=recvmsg(sock,&msg,MSG_CMSG_CLOEXEC);
+    while(received<0 && errno==EINTR);
+    cmsghdr *cmsg=(received>0)?CMSG_FIRSTHDR(&msg):nullptr;
+    if(cmsg==nullptr || cmsg->cmsg_type!=SCM_RIGHTS ||
+       cmsg->cmsg_len!=CMSG_LEN(sizeof(request.fds))) return false;
+    memcpy(request.fds,CMSG_DATA(cmsg),sizeof(request.fds));
+    auto fail=[&](){
+        for(int &fd:request.fds){close(fd);fd=-1;}
+        return false;
+    };
+    if((received<(ssize_t)sizeof(header) &&
+        !readFull(sock,(char *)&header+received,sizeof(header)-received)) ||
+       header.magic!=SERVE_MAGIC || header.count<3 || header.length>SERVE_MAX_REQUEST) return fail();
+    string payload(header.length,'\0');
+    if(!readFull(sock,&payload[0],payload.size()) || payload.empty() || payload.back()!='\0')
+        return fail();
+    vector<string> strings;
+    for(size_t start=0;start<payload.size();){
+        size_t end=payload.find('\0',start);
+        strings.push_back(payload.substr(start,end-start));
+        start=end+1;
+    }
+    if(strings.size()!=header.count) return fail();
+    request.cwd=strings[0];request.entry=strings[1];
+    request.args.assign(strings.begin()+2,strings.end());
+    return true;
+}
+inline bool sendResult(int sock,int32_t result){
+    return writeFull(sock,&result,sizeof(result));
+}
+inline bool receiveResult(int sock,int32_t &result){
+    return readFull(sock,&result,sizeof(result));
+}
+}
+using _daemon_h::connectSocket;
+using _daemon_h::listenSocket;
+using _daemon_h::sendRequest;
+using _daemon_h::receiveRequest;
+using _daemon_h::sendResult;
+using _daemon_h::receiveResult;
+#endif
@@ -0,0 +1,209 @@
+// --trace-env：RuntimeEnv的每个函数指针替换为计数和计时的转发函数，按调用者所在的模块统计
+// 转发函数由runtime_env_generator.py生成在runtime_env_trace.h中，不使用--trace-env时RuntimeEnv不变，没有额外开销
+#pragma once
+#include "module_index.h"
+#include "runtime_stats.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class EnvTracer {
+public:
+    static const int BUCKET_COUNT=48; // 第i个桶为[2^(i-1),2^i)纳秒
+    struct Entry{
+        std::string module; // 调用者所在的模块，不在模块中时为空
+        int slot;
+        // 只由所属的线程写入，输出时由其他线程读取
+        std::atomic<unsigned long long> count{0},total_ns{0};
+        std::atomic<unsigned long long> buckets[BUCKET_COUNT]={};
+    };
+
+    EnvTracer(const ModuleIndex &index,const char *const *names,int slot_count)
+        :index(index),names(names),slot_count(slot_count) {}
+    EnvTracer(const EnvTracer &)=delete;
+    EnvTracer &operator=(const EnvTracer &)=delete;
+
+    static EnvTracer *active; // 转发函数使用的实例
+    // 当前线程最近一次env调用的返回地址，被调用的函数(如env->arenaCreate)由此确定调用者所在的模块
+    static inline thread_local void *caller=nullptr;
+
+    // 在转发函数的开头调用，return_address为调用者的返回地址
+    Entry *enter(int slot,void *return_address) {
+        caller=return_address;
+        const ModuleRange *range=index.find((size_t)return_address);
+        Key key{range?range->start:0,slot};
+        ThreadTable *table=threadTable();
+        Entry *entry;
+        {
+            std::lock_guard<std::mutex> lock(table->mtx); // 只和输出报告的线程竞争
+            auto it=table->entries.find(key);
+            if(it==table->entries.end()){
+                it=table->entries.try_emplace(key).first; // 元素的地址在rehash后不变
+                it->second.module=range?range->name:"";
+                it->second.slot=slot;
+            }
+            entry=&it->second;
+        }
+        entry->count.store(entry->count.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+        return entry;
+    }
+    static void leave(Entry *entry,unsigned long long elapsed_ns) {
+        entry->total_ns.store(entry->total_ns.load(std::memory_order_relaxed)+elapsed_ns,
+                              std::memory_order_relaxed);
+        int bucket=(elapsed_ns==0)?0:64-__builtin_clzll(elapsed_ns);
+        if(bucket>=BUCKET_COUNT) bucket=BUCKET_COUNT-1;
+        std::atomic<unsigned long long> &counter=entry->buckets[bucket];
+        counter.store(counter.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+    }
+
+    // 输出每个模块调用次数最多的函数，以及耗时的中位数和p99(桶的上界)
+    void report(FILE *out,size_t top=10) const {
+        struct Total{
+            unsigned long long count=0,total_ns=0;
+            unsigned long long buckets[BUCKET_COUNT]={};
+        };
+        std::map<std::string,std::map<int,Total>> modules;
+        {
+            std::lock_guard<std::mutex> lock(tables_mutex);
+            for(ThreadTable *table:tables){
+                std::lock_guard<std::mutex> table_lock(table->mtx);
+                for(const auto &[key,entry]:table->entries){
+                    Total &total=modules[entry.module][entry.slot];
+                    total.count+=entry.count.load(std::memory_order_relaxed);
+                    total.total_ns+=entry.total_ns.load(std::memory_order_relaxed);
+                    for(int i=0;i<BUCKET_COUNT;i++)
+                        total.buckets[i]+=entry.buckets[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        fprintf(out,"Env calls:\n");
+        for(const auto &[module,slots]:modules){
+            std::vector<std::pair<int,const Total *>> sorted;
+            unsigned long long module_calls=0;
+            for(const auto &[slot,total]:slots){
+                sorted.emplace_back(slot,&total);
+                module_calls+=total.count;
+            }
+            std::sort(sorted.begin(),sorted.end(),[](const auto &a,const auto &b){
+                return a.second->count>b.second->count;
+            });
+            if(module.empty()) fprintf(out,"<runtime>: %llu calls\n",module_calls);
+            else fprintf(out,"%s%s: %llu calls\n",module.c_str(),FILEEXT,module_calls);
+            fprintf(out,"    %-16s %10s %12s %10s %10s %10s\n",
+                    "function","count","total_us","avg_ns","p50_ns","p99_ns");
+            if(sorted.size()>top) sorted.resize(top);
+            for(const auto &[slot,total]:sorted){
+                fprintf(out,"    %-16s %10llu %12.1f %10llu %10llu %10llu\n",
+                        (slot>=0 && slot<slot_count)?names[slot]:"?",total->count,
+                        total->total_ns/1e3,total->count?total->total_ns/total->count:0,
+                        percentile(total->buckets,total->count,0.5),
+                        percentile(total->buckets,total->count,0.99));
+            }
+        }
+    }
+private:
+    struct Key{
+        size_t module_start;
+        int slot;
+        bool operator==(const Key &other) const {
+            return module_start==other.module_start && slot==other.slot;
+        }
+    };
+    struct KeyHasher{
+        size_t operator()(const Key &key) const {return key.module_start*31+key.slot;}
+    };
+    struct ThreadTable{
+        std::mutex mtx;
+        std::unordered_map<Key,Entry,KeyHasher> entries;
+    };
+    ThreadTable *threadTable() {
+        // 每个线程第一次调用时创建，线程结束后保留，用于最后的报告
+        static thread_local ThreadTable *table=nullptr;
+        if(table==nullptr){
+            table=new ThreadTable;
+            std::lock_guard<std::mutex> lock(tables_mutex);
+            tables.push_back(table);
+        }
+        return table;
+    }
+    static unsigned long long percentile(const unsigned long long *buckets,
+                                         unsigned long long count,double ratio) {
+        unsigned long long target=(unsigned long long)(count*ratio),seen=0;
+        for(int i=0;i<BUCKET_COUNT;i++){
+            seen+=buckets[i];
+            if(seen>target) return (i==0)?0:(1ULL<<i)-1;
+        }
+        return 0;
+    }
+
+    const ModuleIndex &index;
+    const char *const *names;
+    int slot_count;
+    mutable std::mutex tables_mutex;
+    std::vector<ThreadTable *> tables;
+};
+inline EnvTracer *EnvTracer::active=nullptr;
+
+// 返回调用者所在的模块，--trace-env时返回地址位于转发函数中，改用转发函数记录的地址
+inline const ModuleRange *findCallerRange(const ModuleIndex &index,void *return_address) {
+    const ModuleRange *range=index.find((size_t)return_address);
+    if(range==nullptr && EnvTracer::active!=nullptr)
+        range=index.find((size_t)EnvTracer::caller);
+    return range;
+}
+
+// 在转发函数中使用，构造时计数，析构时记录耗时
+class EnvTraceScope {
+public:
+    EnvTraceScope(int slot,void *return_address)
+        :entry(EnvTracer::active->enter(slot,return_address)),start(StatsCollector::now()) {}
+    EnvTraceScope(const EnvTraceScope &)=delete;
+    EnvTraceScope &operator=(const EnvTraceScope &)=delete;
+    ~EnvTraceScope() {EnvTracer::leave(entry,StatsCollector::now()-start);}
+private:
+    EnvTracer::Entry *entry;
+    unsigned long long start;
+};
+
+// 非可变参数函数的转发函数，Index为函数在ENV_TRACE_NAMES中的下标
+// Timed为false时只计数，用于exit、longjmp等不返回的函数，跳出时不会跳过析构函数
+template<int Index,typename Func,bool Timed=true> struct EnvThunk;
+template<int Index,typename R,typename... Args,bool Timed> struct EnvThunk<Index,R (*)(Args...),Timed> {
+    static inline R (*target)(Args...)=nullptr;
+    static R call(Args... args) {
+        if constexpr(Timed){
+            EnvTraceScope scope(Index,__builtin_return_address(0));
+            return target(args...);
+        } else {
+            EnvTracer::active->enter(Index,__builtin_return_address(0));
+            return target(args...);
+        }
+    }
+    static R (*install(R (*original)(Args...)))(Args...) {
+        target=original;
+        return call;
+    }
+};
+template<int Index,typename R,typename... Args,bool Timed> struct EnvThunk<Index,R (*)(Args...) noexcept,Timed> {
+    static inline R (*target)(Args...) noexcept=nullptr;
+    static R call(Args... args) noexcept {
+        if constexpr(Timed){
+            EnvTraceScope scope(Index,__builtin_return_address(0));
+            return target(args...);
+        } else {
+            EnvTracer::active->enter(Index,__builtin_return_address(0));
+            return target(args...);
+        }
+    }
+    static R (*install(R (*original)(Args...) noexcept))(Args...) noexcept {
+        target=original;
+        return call;
+    }
+};
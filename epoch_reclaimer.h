@@ -0,0 +1,132 @@
+// 基于静止状态(QSBR)的延迟释放：被替换的旧模块在所有运行模块代码的线程都经过静止状态之后才释放
+// 静止状态指线程不再持有之前通过getFunc等获取的函数指针，栈上也没有旧模块的帧
+#pragma once
+#include "constants.h"
+#include "module_index.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+class EpochReclaimer {
+public:
+    explicit EpochReclaimer(void (*free_func)(const ModuleInfo &)):free_func(free_func) {}
+
+    // 运行模块代码的线程在开始时注册，结束时注销
+    void registerThread() {
+        initStackBounds(); // 静止状态时需要检查当前线程的栈
+        std::lock_guard<std::mutex> lock(mtx);
+        if(self==nullptr){
+            self=new Participant;
+            participants.push_back(self);
+        }
+        self->epoch.store(global_epoch.load(std::memory_order_acquire),std::memory_order_release);
+        self->online.store(true,std::memory_order_release);
+    }
+    void unregisterThread() {
+        if(self==nullptr) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            participants.erase(std::find(participants.begin(),participants.end(),self));
+            delete self;self=nullptr;
+        }
+        reclaim();
+    }
+    // 长时间阻塞(如等待输入)前后调用，离线的线程不会阻止释放
+    void offline() {
+        if(self!=nullptr) self->online.store(false,std::memory_order_release);
+    }
+    void online() {
+        if(self==nullptr) return;
+        self->epoch.store(global_epoch.load(std::memory_order_acquire),std::memory_order_release);
+        self->online.store(true,std::memory_order_release);
+    }
+
+    // 声明当前线程处于静止状态，没有待释放的模块时只需一次原子读写
+    void quiescent() {
+        if(self==nullptr) return;
+        // 先读取epoch，之后才加入的模块的epoch一定更大，不会被提前释放
+        uint64_t epoch=global_epoch.load(std::memory_order_acquire);
+        if(retired_count.load(std::memory_order_acquire)==0){
+            self->epoch.store(epoch,std::memory_order_release);
+            return;
+        }
+        void *frames[256];
+        size_t count=unwindFramePointers(frames,256,__builtin_frame_address(0));
+        bool stack_known=(stack_bounds.high!=SIZE_MAX);
+        std::lock_guard<std::mutex> lock(mtx);
+        epoch=global_epoch.load(std::memory_order_acquire);
+        for(Retired &item:retired){
+            if(stack_known && !onStack(item.info,frames,count)) continue;
+            // 仍在当前线程的栈上，推迟到下一个宽限期
+            item.epoch=global_epoch.fetch_add(1,std::memory_order_acq_rel)+1;
+            epoch=std::min(epoch,item.epoch-1);
+        }
+        self->epoch.store(epoch,std::memory_order_release);
+    }
+
+    // 加入待释放列表，之后由reclaim释放
+    void retire(const ModuleInfo &info) {
+        retire(info,nullptr);
+    }
+    // 延迟释放其他对象(如动态库)，deleter在宽限期之后调用
+    void retire(std::function<void()> deleter) {
+        retire(ModuleInfo{nullptr,0,0,INVALID_HANDLE},std::move(deleter));
+    }
+    // 释放所有在线线程都已经过静止状态的模块，返回释放的个数
+    size_t reclaim() {
+        std::vector<Retired> freed;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            uint64_t min_epoch=UINT64_MAX;
+            for(Participant *participant:participants){
+                if(participant->online.load(std::memory_order_acquire))
+                    min_epoch=std::min(min_epoch,participant->epoch.load(std::memory_order_acquire));
+            }
+            auto it=std::partition(retired.begin(),retired.end(),
+                                   [&](const Retired &item){return item.epoch>min_epoch;});
+            for(auto cur=it;cur!=retired.end();++cur) freed.push_back(std::move(*cur));
+            retired.erase(it,retired.end());
+            retired_count.store(retired.size(),std::memory_order_release);
+        }
+        for(const Retired &item:freed){
+            if(item.deleter) item.deleter();
+            else free_func(item.info);
+        }
+        return freed.size();
+    }
+    size_t pending() const {return retired_count.load(std::memory_order_acquire);}
+private:
+    struct alignas(64) Participant{ // 独占缓存行，避免线程之间的伪共享
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> online{false};
+    };
+    struct Retired{
+        ModuleInfo info;
+        uint64_t epoch; // 所有在线线程的epoch都不小于它时才能释放
+        std::function<void()> deleter;
+    };
+    void retire(const ModuleInfo &info,std::function<void()> deleter) {
+        std::lock_guard<std::mutex> lock(mtx);
+        retired_count.store(retired.size()+1,std::memory_order_release); // 须在增加epoch之前可见
+        retired.push_back(Retired{info,global_epoch.fetch_add(1,std::memory_order_acq_rel)+1,
+                                  std::move(deleter)});
+    }
+    static bool onStack(const ModuleInfo &info,void **frames,size_t count) {
+        for(size_t i=0;i<count;i++){
+            if((size_t)frames[i]>=(size_t)info.ptr && (size_t)frames[i]<(size_t)info.ptr+info.size)
+                return true;
+        }
+        return false;
+    }
+
+    void (*free_func)(const ModuleInfo &);
+    std::atomic<uint64_t> global_epoch{1};
+    std::atomic<size_t> retired_count{0};
+    std::mutex mtx;
+    std::vector<Participant *> participants;
+    std::vector<Retired> retired;
+    static inline thread_local Participant *self=nullptr;
+};
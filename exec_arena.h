@@ -0,0 +1,154 @@
+// 可执行内存的分配器，将多个小模块紧凑地放在同一批页面中
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+enum ExecArenaFlags{
+    ARENA_HUGEPAGES=1, // 使用2MB大页，失败时退回普通页
+    ARENA_MLOCK=2, // 锁定在物理内存中，避免被换出
+};
+const size_t ARENA_CHUNK_SIZE=64*1024; // 默认每次向系统申请的大小
+const size_t HUGEPAGE_SIZE=2*1024*1024;
+
+class ExecArena {
+public:
+    ExecArena(size_t chunk_size=ARENA_CHUNK_SIZE,int flags=0):flags(flags) {
+        if(flags & ARENA_HUGEPAGES)
+            chunk_size=roundUp(chunk_size,HUGEPAGE_SIZE);
+        this->chunk_size=chunk_size;
+    }
+
+    // 分配size字节的可执行内存，align须为2的幂
+    void *alloc(size_t size,size_t align=16) {
+        if(size==0) size=1;
+        // 优先从已有的块中查找剩余空间，后申请的块剩余空间通常更多
+        for(size_t i=chunks.size();i-->0;){
+            Chunk &chunk=chunks[i];
+            size_t offset=roundUp((size_t)chunk.base+chunk.used,align)-(size_t)chunk.base;
+            if(offset+size<=chunk.size){
+                chunk.used=offset+size;
+                return chunk.base+offset;
+            }
+        }
+        Chunk chunk=newChunk(size+align);
+        size_t offset=roundUp((size_t)chunk.base,align)-(size_t)chunk.base;
+        chunk.used=offset+size;
+        chunks.push_back(chunk);
+        return chunk.base+offset;
+    }
+
+    // 回收某个块中最后一次分配的内存，不是最后一次分配时不回收，返回是否已回收
+    bool release(void *ptr,size_t size) {
+        if(size==0) size=1;
+        for(Chunk &chunk:chunks){
+            if((unsigned char *)ptr>=chunk.base &&
+               (unsigned char *)ptr+size==chunk.base+chunk.used){
+                chunk.used=(unsigned char *)ptr-chunk.base;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 一次性释放所有内存，之前分配的指针全部失效
+    void releaseAll() {
+        for(Chunk &chunk:chunks){
+#ifdef _WIN32
+            if(flags & ARENA_MLOCK) VirtualUnlock(chunk.base,chunk.size);
+            VirtualFree(chunk.base,0,MEM_RELEASE);
+#else
+            munmap(chunk.base,chunk.size); // munmap同时解除mlock
+#endif
+        }
+        chunks.clear();
+    }
+
+    bool contains(const void *ptr) const {
+        for(const Chunk &chunk:chunks){
+            if((const unsigned char *)ptr>=chunk.base &&
+               (const unsigned char *)ptr<chunk.base+chunk.size)
+                return true;
+        }
+        return false;
+    }
+    size_t chunkCount() const {return chunks.size();}
+    size_t mappedBytes() const {
+        size_t total=0;
+        for(const Chunk &chunk:chunks) total+=chunk.size;
+        return total;
+    }
+    size_t usedBytes() const {
+        size_t total=0;
+        for(const Chunk &chunk:chunks) total+=chunk.used;
+        return total;
+    }
+
+    ~ExecArena() {releaseAll();}
+    ExecArena(const ExecArena &)=delete;
+    ExecArena &operator=(const ExecArena &)=delete;
+
+    int flags;
+private:
+    struct Chunk{
+        unsigned char *base;
+        size_t size;
+        size_t used;
+    };
+    static size_t roundUp(size_t value,size_t align) {
+        return (value+align-1)&~(align-1);
+    }
+    Chunk newChunk(size_t minsize) {
+        size_t size=roundUp(minsize>chunk_size?minsize:chunk_size,
+                            (flags & ARENA_HUGEPAGES)?HUGEPAGE_SIZE:pageSize());
+        void *base=nullptr;
+#ifdef _WIN32
+        if(flags & ARENA_HUGEPAGES){ // 需要SeLockMemoryPrivilege权限
+            size_t large=GetLargePageMinimum();
+            if(large!=0)
+                base=VirtualAlloc(NULL,roundUp(size,large),MEM_COMMIT|MEM_RESERVE|MEM_LARGE_PAGES,
+                                  PAGE_EXECUTE_READWRITE);
+            if(base!=NULL) size=roundUp(size,large);
+        }
+        if(base==NULL)
+            base=VirtualAlloc(NULL,size,MEM_COMMIT|MEM_RESERVE,PAGE_EXECUTE_READWRITE);
+        if(base==NULL) throw std::runtime_error("Cannot allocate memory for execution");
+        if(flags & ARENA_MLOCK) VirtualLock(base,size);
+#else
+        const int prot=PROT_READ|PROT_WRITE|PROT_EXEC;
+#ifdef MAP_HUGETLB
+        if(flags & ARENA_HUGEPAGES){ // 需要预先配置vm.nr_hugepages
+            base=mmap(nullptr,size,prot,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+            if(base==MAP_FAILED) base=nullptr;
+        }
+#endif
+        if(base==nullptr){
+            base=mmap(nullptr,size,prot,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+            if(base==MAP_FAILED)
+                throw std::runtime_error("Cannot allocate memory for execution");
+#ifdef MADV_HUGEPAGE
+            if(flags & ARENA_HUGEPAGES) madvise(base,size,MADV_HUGEPAGE); // 退回透明大页
+#endif
+        }
+        if(flags & ARENA_MLOCK) mlock(base,size); // 失败时(如超出RLIMIT_MEMLOCK)仍可使用
+#endif
+        return Chunk{(unsigned char *)base,size,0};
+    }
+    static size_t pageSize() {
+#ifdef _WIN32
+        SYSTEM_INFO info;GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    size_t chunk_size;
+    std::vector<Chunk> chunks;
+};
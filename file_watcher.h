@@ -0,0 +1,130 @@
+// 在后台线程中监视文件的修改，Linux上使用inotify监视文件所在的目录，其他平台定期检查修改时间
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+class FileWatcher {
+public:
+    using Callback=std::function<void(const std::string &)>;
+    // on_change在文件被写入或替换后调用，参数为add时的路径；on_idle每隔interval_ms毫秒调用一次
+    FileWatcher(Callback on_change,std::function<void()> on_idle=nullptr,int interval_ms=200)
+        :on_change(on_change),on_idle(on_idle),interval_ms(interval_ms) {}
+    ~FileWatcher() {stop();}
+    FileWatcher(const FileWatcher &)=delete;
+    FileWatcher &operator=(const FileWatcher &)=delete;
+
+    // 可在任意线程中调用，新的路径在下一次检查时生效；path应为绝对路径，之后改变工作目录不影响监视
+    void add(const std::string &path) {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending.push_back(path);
+    }
+    void start() {
+        if(running.exchange(true)) return;
+        worker=std::thread([this]{run();});
+    }
+    void stop() {
+        if(!running.exchange(false)) return;
+        worker.join();
+    }
+private:
+    struct FileState{
+        long long mtime;
+        long long size;
+    };
+    static FileState statFile(const std::string &path) {
+        struct stat st;
+        if(stat(path.c_str(),&st)!=0) return FileState{-1,-1};
+        return FileState{(long long)st.st_mtime,(long long)st.st_size};
+    }
+    void takePending(std::vector<std::string> &paths) {
+        std::lock_guard<std::mutex> lock(mtx);
+        paths.swap(pending);
+    }
+#ifdef __linux__
+    void run() {
+        int fd=inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if(fd<0){runPolling();return;}
+        std::unordered_map<int,std::string> dirs; // 监视描述符到目录前缀
+        std::unordered_map<std::string,int> dir_wds;
+        std::unordered_set<std::string> watched;
+        std::vector<std::string> paths;
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while(running.load()){
+            takePending(paths);
+            for(const std::string &path:paths){
+                // 编辑器和mv等会以新的inode替换整个文件，因此监视文件所在的目录(cp -f则截断后原地改写)
+                size_t sep=path.find_last_of('/');
+                std::string prefix=(sep==std::string::npos)?"":path.substr(0,sep+1);
+                if(dir_wds.find(prefix)==dir_wds.end()){
+                    int wd=inotify_add_watch(fd,prefix.empty()?".":prefix.c_str(),
+                                             IN_CLOSE_WRITE|IN_MOVED_TO);
+                    if(wd<0) continue;
+                    dirs[wd]=prefix;dir_wds[prefix]=wd;
+                }
+                watched.insert(path);
+            }
+            paths.clear();
+            struct pollfd pfd{fd,POLLIN,0};
+            if(poll(&pfd,1,interval_ms)>0){
+                std::unordered_set<std::string> changed; // 合并同一文件的多个事件
+                ssize_t len;
+                while((len=read(fd,buf,sizeof(buf)))>0){
+                    for(char *p=buf;p<buf+len;){
+                        struct inotify_event *event=(struct inotify_event *)p;
+                        auto dir=dirs.find(event->wd);
+                        if(event->len>0 && dir!=dirs.end()){
+                            std::string path=dir->second+event->name;
+                            if(watched.count(path)) changed.insert(path);
+                        }
+                        p+=sizeof(struct inotify_event)+event->len;
+                    }
+                }
+                for(const std::string &path:changed) on_change(path);
+            }
+            if(on_idle) on_idle();
+        }
+        close(fd);
+    }
+#else
+    void run() {runPolling();}
+#endif
+    void runPolling() {
+        std::unordered_map<std::string,FileState> states;
+        std::vector<std::string> paths;
+        while(running.load()){
+            takePending(paths);
+            for(const std::string &path:paths) states.emplace(path,statFile(path));
+            paths.clear();
+            for(auto &[path,state]:states){
+                FileState current=statFile(path);
+                if(current.mtime<0 || (current.mtime==state.mtime && current.size==state.size))
+                    continue;
+                state=current;
+                on_change(path);
+            }
+            if(on_idle) on_idle();
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        }
+    }
+
+    Callback on_change;
+    std::function<void()> on_idle;
+    int interval_ms;
+    std::atomic<bool> running{false};
+    std::mutex mtx;
+    std::vector<std::string> pending;
+    std::thread worker;
+};
@@ -0,0 +1,141 @@
+// 供bin文件使用的bump分配器，用于env->arenaCreate等
+// 每个线程从自己当前的块中分配，不加锁；块用完时才加锁申请新的块，reset和析构时统一释放
+// 可用setBudget将申请的块计入模块的内存用量(--mem-track)
+// 每个线程在每个arena中的分配位置保存在arena中，线程局部的缓存只记录指向它的指针，多个arena交替使用时不会丢弃未用完的块
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class HeapArena {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE=64*1024;
+    static const size_t ALIGN=alignof(std::max_align_t);
+
+    // owner为所属模块的起始地址，为0时不属于任何模块
+    explicit HeapArena(size_t chunk_size=0,size_t owner=0)
+        :chunk_size(chunk_size?roundUp(chunk_size,ALIGN):DEFAULT_CHUNK_SIZE),owner(owner),
+         id(next_id.fetch_add(1,std::memory_order_relaxed)) {}
+    HeapArena(const HeapArena &)=delete;
+    HeapArena &operator=(const HeapArena &)=delete;
+    ~HeapArena() {
+        size_t total=0;
+        for(Chunk &chunk:chunks){std::free(chunk.base);total+=chunk.size;}
+        for(Chunk &chunk:free_chunks){std::free(chunk.base);total+=chunk.size;}
+        if(release_bytes && total) release_bytes(total);
+    }
+
+    // 向系统申请和释放块时调用，用于将块计入模块的内存用量，charge返回false时分配失败；在第一次分配之前设置
+    void setBudget(std::function<bool(size_t)> charge,std::function<void(size_t)> release) {
+        charge_bytes=charge;release_bytes=release;
+    }
+
+    // 分配按ALIGN对齐的size字节，失败时返回nullptr，可在多个线程中同时调用
+    void *alloc(size_t size) {
+        size=roundUp(size?size:1,ALIGN);
+        uint64_t generation=this->generation.load(std::memory_order_acquire);
+        CacheSlot &slot=cache[id%CACHE_SIZE];
+        if(slot.id==id){
+            Cursor &cursor=*slot.cursor;
+            if(cursor.generation==generation && (size_t)(cursor.end-cursor.cur)>=size){
+                char *ptr=cursor.cur;
+                cursor.cur+=size;
+                return ptr;
+            }
+        }
+        return allocSlow(slot,size);
+    }
+    // 之前分配的内存全部失效，块保留给之后的分配，调用时不能有其他线程正在分配
+    void reset() {
+        std::lock_guard<std::mutex> lock(mtx);
+        for(Chunk &chunk:chunks){
+            if(chunk.size==chunk_size) free_chunks.push_back(chunk);
+            else{ // 单独申请的大块不再复用
+                std::free(chunk.base);
+                if(release_bytes) release_bytes(chunk.size);
+            }
+        }
+        chunks.clear();
+        generation.fetch_add(1,std::memory_order_release); // 各线程缓存的位置随之失效
+    }
+    size_t mappedBytes() {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t total=0;
+        for(const Chunk &chunk:chunks) total+=chunk.size;
+        for(const Chunk &chunk:free_chunks) total+=chunk.size;
+        return total;
+    }
+    const size_t chunk_size;
+    const size_t owner;
+private:
+    struct Chunk{
+        char *base;
+        size_t size;
+    };
+    struct Cursor{ // 一个线程在本arena中当前分配的位置，只由该线程修改
+        uint64_t generation=0;
+        char *cur=nullptr,*end=nullptr;
+    };
+    struct CacheSlot{ // 线程局部的缓存，以arena的id区分，arena释放后id不会重复，因此不会访问已释放的cursor
+        uint64_t id=0;
+        Cursor *cursor=nullptr;
+    };
+    static const size_t CACHE_SIZE=8;
+    static size_t roundUp(size_t value,size_t align) {
+        return (value+align-1)&~(align-1);
+    }
+    void *allocSlow(CacheSlot &slot,size_t size) {
+        std::lock_guard<std::mutex> lock(mtx);
+        Cursor &cursor=cursors[std::this_thread::get_id()]; // 元素的地址在rehash后不变
+        slot.id=id;slot.cursor=&cursor;
+        uint64_t generation=this->generation.load(std::memory_order_relaxed);
+        if(cursor.generation==generation && (size_t)(cursor.end-cursor.cur)>=size){
+            char *ptr=cursor.cur; // 缓存被其他arena占用后，继续使用当前线程原来的块
+            cursor.cur+=size;
+            return ptr;
+        }
+        Chunk chunk;
+        if(size>chunk_size/4){ // 较大的分配单独申请，不浪费当前线程的块
+            chunk.base=(char *)newChunk(size);
+            if(chunk.base==nullptr) return nullptr;
+            chunk.size=size;
+            chunks.push_back(chunk);
+            return chunk.base;
+        }
+        if(!free_chunks.empty()){
+            chunk=free_chunks.back();free_chunks.pop_back();
+        } else {
+            chunk.base=(char *)newChunk(chunk_size); // malloc的结果已按max_align_t对齐
+            if(chunk.base==nullptr) return nullptr;
+            chunk.size=chunk_size;
+        }
+        chunks.push_back(chunk);
+        cursor.generation=generation;
+        cursor.cur=chunk.base+size;
+        cursor.end=chunk.base+chunk.size;
+        return chunk.base;
+    }
+    void *newChunk(size_t size) {
+        if(charge_bytes && !charge_bytes(size)) return nullptr;
+        void *base=std::malloc(size);
+        if(base==nullptr && release_bytes) release_bytes(size);
+        return base;
+    }
+
+    const uint64_t id;
+    std::atomic<uint64_t> generation{0};
+    std::mutex mtx; // 保护chunks、free_chunks和cursors
+    std::vector<Chunk> chunks,free_chunks;
+    std::unordered_map<std::thread::id,Cursor> cursors;
+    std::function<bool(size_t)> charge_bytes;
+    std::function<void(size_t)> release_bytes;
+    static inline std::atomic<uint64_t> next_id{1};
+    static thread_local CacheSlot cache[CACHE_SIZE];
+};
+inline thread_local HeapArena::CacheSlot HeapArena::cache[HeapArena::CACHE_SIZE];
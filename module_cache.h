@@ -0,0 +1,136 @@
+// 按内容寻址的模块缓存，内容相同的模块只保留一份，并记录引用计数
+#pragma once
+#include "constants.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+struct ModuleHash{
+    uint64_t low;
+    uint64_t high;
+    size_t size;
+    bool operator==(const ModuleHash &other) const {
+        return low==other.low && high==other.high && size==other.size;
+    }
+};
+struct ModuleHashHasher{
+    size_t operator()(const ModuleHash &hash) const {return (size_t)hash.low;}
+};
+
+// 128位的非加密哈希，参考XXH3的累加方式：8个64位通道，每次处理64字节，
+// 只使用32x32->64位乘法和加法，编译器可向量化为SSE2/AVX2指令
+inline ModuleHash hashModule(const void *data,size_t size){
+    static const uint64_t KEYS[8]={
+        0xbe4ba423396cfeb8ULL,0x1cad21f72c81017cULL,0xdb979083e96dd4deULL,0x1f67b3b7a4a44072ULL,
+        0x78e5c0cc4ee679cbULL,0x2172ffcc7dd05a82ULL,0x8e2443f7744608b8ULL,0x4c263a81e69035e0ULL};
+    const uint64_t PRIME32=0x9e3779b1ULL,PRIME64_1=0x9e3779b185ebca87ULL,
+                   PRIME64_2=0xc2b2ae3d27d4eb4fULL;
+    uint64_t acc[8]={PRIME32,PRIME64_1,PRIME64_2,0x165667b19e3779f9ULL,
+                     0x85ebca77c2b2ae63ULL,0x27d4eb2f165667c5ULL,PRIME64_2,PRIME32};
+    const unsigned char *p=(const unsigned char *)data;
+    unsigned char tail[64];
+    for(size_t offset=0,stripe=0;;offset+=64,stripe++){
+        const unsigned char *block=p+offset;
+        size_t remain=size-offset;
+        if(remain<64){ // 最后不足64字节的部分补0
+            memset(tail,0,sizeof(tail));
+            if(remain>0) memcpy(tail,block,remain);
+            block=tail;
+        }
+        for(int i=0;i<8;i++){
+            uint64_t value,key;
+            memcpy(&value,block+i*8,8);
+            key=value^KEYS[i];
+            acc[i^1]+=value;
+            acc[i]+=(key&0xffffffff)*(key>>32);
+        }
+        if(stripe%16==15){ // 定期打乱，避免低位的信息丢失
+            for(int i=0;i<8;i++){
+                acc[i]^=acc[i]>>47;
+                acc[i]^=KEYS[i];
+                acc[i]*=PRIME32;
+            }
+        }
+        if(remain<=64) break;
+    }
+    auto mix=[](uint64_t value){
+        value^=value>>33;value*=0xff51afd7ed558ccdULL;
+        value^=value>>33;value*=0xc4ceb9fe1a85ec53ULL;
+        return value^(value>>33);
+    };
+    ModuleHash result{size*PRIME64_1,~size*PRIME64_2,size};
+    for(int i=0;i<8;i++){
+        result.low=mix(result.low^acc[i])+KEYS[i];
+        result.high=mix(result.high+(acc[i]^KEYS[7-i]));
+    }
+    return result;
+}
+
+class ModuleCache {
+public:
+    struct Entry{
+        ModuleHash hash;
+        ModuleInfo info;
+        size_t refcount;
+        bool linked; // 是否已填入导入槽，内容相同的模块共享同一份导入槽
+        std::vector<const void *> deps; // 导入槽引用的其他缓存项，释放时一并减少引用计数，循环引用不会被释放
+    };
+
+    // 查找内容相同的模块，找到时增加引用计数并返回它，否则返回nullptr
+    const Entry *acquire(const ModuleHash &hash) {
+        auto it=entries.find(hash);
+        if(it==entries.end()) return nullptr;
+        it->second.refcount++;
+        return &it->second;
+    }
+    void insert(const ModuleHash &hash,const ModuleInfo &info) {
+        Entry &entry=entries[hash];
+        entry=Entry{hash,info,1,false,{}};
+        by_address[(size_t)info.ptr]=hash;
+    }
+    // 查找包含ptr的缓存项
+    Entry *find(const void *ptr) {
+        auto it=by_address.upper_bound((size_t)ptr);
+        if(it==by_address.begin()) return nullptr;
+        --it;
+        Entry &entry=entries.at(it->second);
+        if((size_t)ptr!=(size_t)entry.info.ptr &&
+           (size_t)ptr>=(size_t)entry.info.ptr+entry.info.size) return nullptr;
+        return &entry;
+    }
+    // 第一次调用时返回true，用于只填入一次导入槽
+    bool markLinked(const void *ptr) {
+        Entry *entry=find(ptr);
+        if(entry==nullptr) return true;
+        if(entry->linked) return false;
+        entry->linked=true;
+        return true;
+    }
+    // 记录owner的导入槽引用了target，target在owner释放前不会被释放
+    void addDependency(const void *owner,const void *target) {
+        Entry *owner_entry=find(owner),*target_entry=find(target);
+        if(owner_entry==nullptr || target_entry==nullptr || owner_entry==target_entry) return;
+        target_entry->refcount++;
+        owner_entry->deps.push_back(target_entry->info.ptr);
+    }
+    // 减少引用计数，减为0的缓存项(包括因此不再被引用的依赖)被移出缓存，并加入freed
+    void release(const void *ptr,std::vector<ModuleInfo> &freed) {
+        std::vector<const void *> pending{ptr};
+        while(!pending.empty()){
+            Entry *entry=find(pending.back());pending.pop_back();
+            if(entry==nullptr || --entry->refcount>0) continue;
+            freed.push_back(entry->info);
+            pending.insert(pending.end(),entry->deps.begin(),entry->deps.end());
+            ModuleHash hash=entry->hash;
+            by_address.erase((size_t)entry->info.ptr);
+            entries.erase(hash);
+        }
+    }
+    size_t size() const {return entries.size();}
+private:
+    std::unordered_map<ModuleHash,Entry,ModuleHashHasher> entries;
+    std::map<size_t,ModuleHash> by_address; // 按起始地址排序，用于由地址查找缓存项
+};
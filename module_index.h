@@ -0,0 +1,179 @@
+// 已加载模块的地址索引，以及不依赖系统符号的栈回溯，可在信号处理函数中使用
+#pragma once
+#include "constants.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+struct ModuleRange{
+    size_t start;
+    size_t end; // 不含end
+    const char *name;
+};
+
+class ModuleIndex {
+public:
+    // 按imported_funcs重新生成索引，在每次导入、重新加载后调用
+    void rebuild(const std::unordered_map<std::string,ModuleInfo> &modules) {
+        size_t names_size=0;
+        for(const auto &[name,info]:modules) names_size+=name.size()+1;
+        Snapshot *snapshot=new Snapshot;
+        snapshot->names=new char[names_size+1];
+        snapshot->ranges=new ModuleRange[modules.size()+1];
+        char *name_ptr=snapshot->names;size_t count=0;
+        for(const auto &[name,info]:modules){
+            memcpy(name_ptr,name.c_str(),name.size()+1);
+            snapshot->ranges[count++]=ModuleRange{
+                (size_t)info.ptr,(size_t)info.ptr+info.size,name_ptr};
+            name_ptr+=name.size()+1;
+        }
+        std::sort(snapshot->ranges,snapshot->ranges+count,
+                  [](const ModuleRange &a,const ModuleRange &b){return a.start<b.start;});
+        snapshot->count=count;
+        Snapshot *old=current.exchange(snapshot,std::memory_order_acq_rel);
+        // 旧的快照保留到索引析构：读取者(信号处理函数、未注册的线程)无法参与延迟释放，
+        // 且find返回的ModuleRange及其名称在整个运行期间有效，可以在采样时直接保存
+        if(old!=nullptr) retired.push_back(old);
+    }
+
+    // 二分查找包含address的模块，不申请内存、不加锁，可在信号处理函数中调用
+    const ModuleRange *find(size_t address) const {
+        const Snapshot *snapshot=current.load(std::memory_order_acquire);
+        if(snapshot==nullptr) return nullptr;
+        size_t low=0,high=snapshot->count;
+        while(low<high){ // 查找第一个start>address的位置
+            size_t mid=low+(high-low)/2;
+            if(snapshot->ranges[mid].start<=address) low=mid+1;
+            else high=mid;
+        }
+        if(low==0) return nullptr;
+        const ModuleRange *range=&snapshot->ranges[low-1];
+        return (address<range->end)?range:nullptr;
+    }
+    size_t size() const {
+        const Snapshot *snapshot=current.load(std::memory_order_acquire);
+        return snapshot?snapshot->count:0;
+    }
+
+    ~ModuleIndex() {
+        delete current.load();
+        for(Snapshot *snapshot:retired) delete snapshot;
+    }
+private:
+    struct Snapshot{
+        ModuleRange *ranges=nullptr;
+        size_t count=0;
+        char *names=nullptr;
+        ~Snapshot(){delete[] ranges;delete[] names;}
+    };
+    std::atomic<Snapshot*> current{nullptr};
+    std::vector<Snapshot *> retired; // 只由rebuild修改，rebuild须在registry_mutex中调用
+};
+
+// -- 基于帧指针的栈回溯 --
+// bin文件需要以-fno-omit-frame-pointer编译，否则回溯会在bin文件的帧处中断
+struct StackBounds{
+    size_t low;
+    size_t high;
+};
+static thread_local StackBounds stack_bounds{0,SIZE_MAX};
+inline void initStackBounds() {
+    // 记录当前线程的栈范围，回溯时用于检查帧指针，在线程开始时调用
+#if !defined(_WIN32) && defined(__GLIBC__)
+    pthread_attr_t attr;void *addr;size_t size;
+    if(pthread_getattr_np(pthread_self(),&attr)==0){
+        if(pthread_attr_getstack(&attr,&addr,&size)==0)
+            stack_bounds=StackBounds{(size_t)addr,(size_t)addr+size};
+        pthread_attr_destroy(&attr);
+    }
+#elif defined(_WIN32)
+    NT_TIB *tib=(NT_TIB *)NtCurrentTeb();
+    stack_bounds=StackBounds{(size_t)tib->StackLimit,(size_t)tib->StackBase};
+#endif
+}
+// 从帧指针fp开始回溯，pc不为nullptr时作为第0帧，返回获取的帧数，可在信号处理函数中调用
+inline size_t unwindFramePointers(void **frames,size_t max_frames,void *fp,void *pc=nullptr) {
+    size_t count=0;
+    if(pc!=nullptr && count<max_frames) frames[count++]=pc;
+    size_t cur=(size_t)fp;
+    while(count<max_frames){
+        if(cur<stack_bounds.low || cur+2*sizeof(void *)>stack_bounds.high ||
+           cur%sizeof(void *)!=0)
+            break;
+        size_t *frame=(size_t *)cur; // frame[0]为上一个帧指针，frame[1]为返回地址
+        size_t next=frame[0];
+        if(frame[1]==0) break;
+        frames[count++]=(void *)frame[1];
+        if(next<=cur) break; // 栈向低地址增长，上一帧的地址必须更高
+        cur=next;
+    }
+    return count;
+}
+// 从信号处理函数的上下文回溯，pc不在任何模块中时(调用空指针、没有建立帧的叶函数如strlen)，
+// 模块的帧会被跳过，此时栈顶为返回地址，位于模块中时作为调用者插入，可在信号处理函数中调用
+inline size_t unwindSignalContext(const ModuleIndex &index,void **frames,size_t max_frames,
+                                  void *fp,void *pc,void *sp) {
+    if(max_frames==0) return 0;
+    size_t count=0;
+    frames[count++]=pc; // 调用空指针时pc为0，仍作为第0帧
+    void *caller=nullptr;
+    size_t top=(size_t)sp;
+    if(index.find((size_t)pc)==nullptr && count<max_frames &&
+       top>=stack_bounds.low && top+sizeof(void *)<=stack_bounds.high && top%sizeof(void *)==0){
+        caller=*(void **)top;
+        if(index.find((size_t)caller)!=nullptr) frames[count++]=caller;
+        else caller=nullptr;
+    }
+    size_t unwound=unwindFramePointers(frames+count,max_frames-count,fp);
+    if(caller!=nullptr && unwound>0 && frames[count]==caller){ // 已建立帧的函数，回溯已包含调用者
+        memmove(frames+count,frames+count+1,(unwound-1)*sizeof(void *));
+        unwound--;
+    }
+    return count+unwound;
+}
+
+#ifndef _WIN32
+// 不依赖printf的输出函数，可在信号处理函数中调用
+inline void writeString(int fd,const char *str) {
+    ssize_t result=write(fd,str,strlen(str));
+    (void)result;
+}
+inline void writeHex(int fd,size_t value) {
+    char buf[2+sizeof(size_t)*2+1];
+    char *p=buf+sizeof(buf)-1;*p='\0';
+    do{
+        *--p="0123456789abcdef"[value&0xf];
+        value>>=4;
+    }while(value!=0);
+    *--p='x';*--p='0';
+    writeString(fd,p);
+}
+// 输出一帧，bin文件中的帧输出为"模块名+偏移量"，可在信号处理函数中调用
+inline void writeFrame(int fd,const ModuleIndex &index,void *address) {
+    const ModuleRange *range=index.find((size_t)address);
+    if(range!=nullptr){
+        writeString(fd,range->name);
+        writeString(fd,FILEEXT);
+        writeString(fd,"+");
+        writeHex(fd,(size_t)address-range->start);
+        writeString(fd," [");
+        writeHex(fd,(size_t)address);
+        writeString(fd,"]\n");
+    } else {
+        writeString(fd,"<Unknown module> [");
+        writeHex(fd,(size_t)address);
+        writeString(fd,"]\n");
+    }
+}
+#endif
@@ -0,0 +1,284 @@
+// --mem-track：将env->malloc、fopen等替换为记账的版本，按调用者的返回地址将堆内存和打开的文件归属到模块
+// 每个模块统计当前和峰值的字节数、文件数，并可设置字节数的上限，超出时分配失败(errno为ENOMEM)
+// env->arenaCreate创建的HeapArena申请的块计入创建者所在的模块，同样受上限限制
+// 不使用--mem-track时RuntimeEnv不变，没有额外开销
+#pragma once
+#include "runtime_env.h"
+#include "module_index.h"
+#include "env_trace.h"
+#include "concurrent_registry.h"
+#include "heap_arena.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MemoryAccountant {
+public:
+    struct Account{
+        std::string name; // 模块名，不在模块中的调用为空
+        unsigned long long quota=0; // 0表示不限制
+        std::atomic<unsigned long long> live{0},peak{0},allocations{0};
+        std::atomic<unsigned long long> files{0},peak_files{0},denied{0};
+        std::atomic<unsigned long long> arena_bytes{0}; // live中属于HeapArena的块的部分
+    };
+
+    // default_quota为每个模块默认的字节数上限，不适用于运行时自身
+    MemoryAccountant(const ModuleIndex &index,unsigned long long default_quota=0)
+        :index(index),default_quota(default_quota) {
+        runtime_account.name="";
+    }
+    MemoryAccountant(const MemoryAccountant &)=delete;
+    MemoryAccountant &operator=(const MemoryAccountant &)=delete;
+
+    static MemoryAccountant *active; // 替换后的env函数使用的实例
+
+    // 单独设置某个模块的上限，在install之前调用
+    void setQuota(const std::string &module,unsigned long long bytes) {quotas[module]=bytes;}
+
+    // 替换env中分配和释放内存、打开和关闭文件的函数，原来的函数用于实际的操作
+    void install(RuntimeEnv *env) {
+        active=this;
+        real_malloc=env->malloc;real_calloc=env->calloc;
+        real_realloc=env->realloc;real_free=env->free;real_strdup=env->strdup;
+        real_fopen=env->fopen;real_freopen=env->freopen;real_fclose=env->fclose;
+        env->malloc=trackedMalloc;env->calloc=trackedCalloc;
+        env->realloc=trackedRealloc;env->free=trackedFree;env->strdup=trackedStrdup;
+        env->fopen=trackedFopen;env->freopen=trackedFreopen;env->fclose=trackedFclose;
+    }
+
+    // 将arena申请的块计入return_address所在的模块，超出上限时arena的分配失败，在arenaCreate中调用
+    void trackArena(HeapArena &arena,void *return_address) {
+        Account *account=callerAccount(return_address);
+        arena.setBudget([account](size_t bytes){
+            if(!charge(account,bytes)) return false;
+            account->arena_bytes.fetch_add(bytes,std::memory_order_relaxed);
+            return true;
+        },[account](size_t bytes){
+            account->live.fetch_sub(bytes,std::memory_order_relaxed);
+            account->arena_bytes.fetch_sub(bytes,std::memory_order_relaxed);
+        });
+    }
+
+    // 模块当前的用量，module为nullptr时为return_address所在的模块，模块尚无记录时返回false
+    bool usage(const char *module,void *return_address,ModuleMemoryStats &stats) {
+        Account *account;
+        if(module!=nullptr){
+            if(!accounts.find(module,account)) return false;
+        } else account=callerAccount(return_address);
+        stats.live_bytes=account->live.load(std::memory_order_relaxed);
+        stats.peak_bytes=account->peak.load(std::memory_order_relaxed);
+        stats.allocations=account->allocations.load(std::memory_order_relaxed);
+        stats.open_files=account->files.load(std::memory_order_relaxed);
+        stats.peak_open_files=account->peak_files.load(std::memory_order_relaxed);
+        stats.quota_bytes=account->quota;
+        stats.denied=account->denied.load(std::memory_order_relaxed);
+        stats.arena_bytes=account->arena_bytes.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    // 按峰值从大到小输出每个模块的用量，仍未释放的内存和文件可能是泄漏
+    void report(FILE *out) {
+        std::vector<Account *> sorted;
+        {
+            std::lock_guard<std::mutex> lock(accounts_mutex);
+            for(Account &account:account_list) sorted.push_back(&account);
+        }
+        sorted.push_back(&runtime_account);
+        std::sort(sorted.begin(),sorted.end(),[](const Account *a,const Account *b){
+            return a->peak.load(std::memory_order_relaxed)>b->peak.load(std::memory_order_relaxed);
+        });
+        fprintf(out,"Module memory:\n");
+        fprintf(out,"    %-20s %12s %12s %12s %10s %6s %6s %12s %8s\n",
+                "module","live","arena","peak","allocs","files","peak","quota","denied");
+        for(const Account *account:sorted){
+            if(account->peak.load(std::memory_order_relaxed)==0 &&
+               account->allocations.load(std::memory_order_relaxed)==0 &&
+               account->peak_files.load(std::memory_order_relaxed)==0 &&
+               account->denied.load(std::memory_order_relaxed)==0) continue;
+            std::string name=account->name.empty()?"<runtime>":account->name+FILEEXT;
+            char quota[24]="-";
+            if(account->quota) snprintf(quota,sizeof(quota),"%llu",account->quota);
+            fprintf(out,"    %-20s %12llu %12llu %12llu %10llu %6llu %6llu %12s %8llu\n",name.c_str(),
+                    account->live.load(std::memory_order_relaxed),
+                    account->arena_bytes.load(std::memory_order_relaxed),
+                    account->peak.load(std::memory_order_relaxed),
+                    account->allocations.load(std::memory_order_relaxed),
+                    account->files.load(std::memory_order_relaxed),
+                    account->peak_files.load(std::memory_order_relaxed),quota,
+                    account->denied.load(std::memory_order_relaxed));
+        }
+    }
+private:
+    // 每个已记账的内存块或文件的所属模块和大小，按地址分片，减少多线程分配时的竞争
+    struct Record{
+        Account *account;
+        size_t size;
+        bool file; // env->fopen打开的文件，size为0
+    };
+    static const size_t SHARD_COUNT=64;
+    struct alignas(64) Shard{
+        std::mutex mtx;
+        std::unordered_map<void *,Record> records;
+    };
+    Shard &shard(void *ptr) {return shards[((size_t)ptr>>4)%SHARD_COUNT];}
+
+    Account *callerAccount(void *return_address) {
+        const ModuleRange *range=findCallerRange(index,return_address);
+        if(range==nullptr) return &runtime_account;
+        Account *account;
+        if(accounts.find(range->name,account)) return account;
+        std::lock_guard<std::mutex> lock(accounts_mutex);
+        if(accounts.find(range->name,account)) return account; // 其他线程已创建
+        account=&account_list.emplace_back();
+        account->name=range->name;
+        auto it=quotas.find(account->name);
+        account->quota=(it!=quotas.end())?it->second:default_quota;
+        accounts.insert(account->name,account);
+        return account;
+    }
+    static void raiseMax(std::atomic<unsigned long long> &max,unsigned long long value) {
+        unsigned long long current=max.load(std::memory_order_relaxed);
+        while(value>current && !max.compare_exchange_weak(current,value,std::memory_order_relaxed));
+    }
+    // 计入size字节，超出上限时不计入并返回false
+    static bool charge(Account *account,size_t size) {
+        unsigned long long live=account->live.fetch_add(size,std::memory_order_relaxed)+size;
+        if(account->quota && live>account->quota){
+            account->live.fetch_sub(size,std::memory_order_relaxed);
+            account->denied.fetch_add(1,std::memory_order_relaxed);
+            return false;
+        }
+        raiseMax(account->peak,live);
+        return true;
+    }
+    void remember(void *ptr,Account *account,size_t size,bool file=false) {
+        Shard &s=shard(ptr);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.records[ptr]=Record{account,size,file};
+    }
+    bool forget(void *ptr,Record &record) {
+        Shard &s=shard(ptr);
+        std::lock_guard<std::mutex> lock(s.mtx);
+        auto it=s.records.find(ptr);
+        if(it==s.records.end()) return false; // 在--mem-track之前或由库函数分配
+        record=it->second;
+        s.records.erase(it);
+        return true;
+    }
+    void *allocated(void *ptr,Account *account,size_t size) {
+        if(ptr==nullptr){
+            account->live.fetch_sub(size,std::memory_order_relaxed);
+            return nullptr;
+        }
+        account->allocations.fetch_add(1,std::memory_order_relaxed);
+        remember(ptr,account,size);
+        return ptr;
+    }
+    void released(void *ptr) {
+        Record record;
+        if(ptr==nullptr || !forget(ptr,record)) return;
+        if(!record.file) record.account->live.fetch_sub(record.size,std::memory_order_relaxed);
+        else record.account->files.fetch_sub(1,std::memory_order_relaxed);
+    }
+    FILE *opened(FILE *file,Account *account) {
+        if(file==nullptr) return nullptr;
+        unsigned long long files=account->files.fetch_add(1,std::memory_order_relaxed)+1;
+        raiseMax(account->peak_files,files);
+        remember(file,account,0,true);
+        return file;
+    }
+    static void *denied() {
+        errno=ENOMEM;
+        return nullptr;
+    }
+
+    // 替换env中的函数，须在模块直接调用的函数中取返回地址
+    static void *trackedMalloc(size_t size) noexcept {
+        Account *account=active->callerAccount(__builtin_return_address(0));
+        if(!charge(account,size)) return denied();
+        return active->allocated(real_malloc(size),account,size);
+    }
+    static void *trackedCalloc(size_t count,size_t size) noexcept {
+        Account *account=active->callerAccount(__builtin_return_address(0));
+        if(size && count>SIZE_MAX/size) return denied();
+        if(!charge(account,count*size)) return denied();
+        return active->allocated(real_calloc(count,size),account,count*size);
+    }
+    static void *trackedRealloc(void *ptr,size_t size) noexcept {
+        if(ptr==nullptr){
+            Account *account=active->callerAccount(__builtin_return_address(0));
+            if(!charge(account,size)) return denied();
+            return active->allocated(real_realloc(nullptr,size),account,size);
+        }
+        Record record;
+        if(!active->forget(ptr,record)) return real_realloc(ptr,size);
+        if(size==0){ // 等同于释放
+            record.account->live.fetch_sub(record.size,std::memory_order_relaxed);
+            return real_realloc(ptr,0);
+        }
+        // 仍归属于申请原内存块的模块，只计入增加的部分
+        if(size>record.size && !charge(record.account,size-record.size)){
+            active->remember(ptr,record.account,record.size);
+            return denied();
+        }
+        void *result=real_realloc(ptr,size);
+        if(result==nullptr){ // 原内存块不变
+            if(size>record.size) record.account->live.fetch_sub(size-record.size,std::memory_order_relaxed);
+            active->remember(ptr,record.account,record.size);
+            return nullptr;
+        }
+        if(size<record.size) record.account->live.fetch_sub(record.size-size,std::memory_order_relaxed);
+        active->remember(result,record.account,size);
+        return result;
+    }
+    static void trackedFree(void *ptr) noexcept {
+        active->released(ptr);
+        real_free(ptr);
+    }
+    static char *trackedStrdup(const char *str) noexcept {
+        Account *account=active->callerAccount(__builtin_return_address(0));
+        size_t size=strlen(str)+1;
+        if(!charge(account,size)) return (char *)denied();
+        return (char *)active->allocated(real_strdup(str),account,size);
+    }
+    static FILE *trackedFopen(const char *path,const char *mode) noexcept {
+        Account *account=active->callerAccount(__builtin_return_address(0));
+        return active->opened(real_fopen(path,mode),account);
+    }
+    static FILE *trackedFreopen(const char *path,const char *mode,FILE *stream) noexcept {
+        FILE *file=real_freopen(path,mode,stream);
+        if(file==nullptr) active->released(stream); // 失败时原来的文件已被关闭
+        return file;
+    }
+    static int trackedFclose(FILE *file) noexcept {
+        active->released(file);
+        return real_fclose(file);
+    }
+
+    const ModuleIndex &index;
+    unsigned long long default_quota;
+    std::unordered_map<std::string,unsigned long long> quotas;
+    ConcurrentMap<Account *> accounts; // 模块名到账户，查找不加锁
+    std::mutex accounts_mutex; // 创建账户时加锁
+    std::deque<Account> account_list; // 账户只增不删，元素的地址不变
+    Account runtime_account;
+    Shard shards[SHARD_COUNT];
+    static inline void *(*real_malloc)(size_t)=nullptr;
+    static inline void *(*real_calloc)(size_t,size_t)=nullptr;
+    static inline void *(*real_realloc)(void *,size_t)=nullptr;
+    static inline void (*real_free)(void *)=nullptr;
+    static inline char *(*real_strdup)(const char *)=nullptr;
+    static inline FILE *(*real_fopen)(const char *,const char *)=nullptr;
+    static inline FILE *(*real_freopen)(const char *,const char *,FILE *)=nullptr;
+    static inline int (*real_fclose)(FILE *)=nullptr;
+};
+inline MemoryAccountant *MemoryAccountant::active=nullptr;
@@ -0,0 +1,135 @@
+// 为Linux perf记录已加载模块的地址：/tmp/perf-<pid>.map，以及可选的jitdump文件(包含机器码，用于perf annotate)
+// jitdump的格式参考Linux源码中的tools/perf/Documentation/jitdump-specification.txt
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+class PerfMapWriter {
+public:
+    static bool supported() {
+#ifdef __linux__
+        return true;
+#else
+        return false;
+#endif
+    }
+    // jitdump_dir不为空时同时在该目录中生成jit-<pid>.dump
+    PerfMapWriter(bool perf_map,const std::string &jitdump_dir) {
+#ifdef __linux__
+        pid_t pid=getpid();
+        if(perf_map){
+            std::string path="/tmp/perf-"+std::to_string(pid)+".map";
+            map_file=fopen(path.c_str(),"w");
+            if(map_file==nullptr) fprintf(stderr,"Warning: cannot create %s\n",path.c_str());
+        }
+        if(!jitdump_dir.empty()) openJitdump(jitdump_dir+"/jit-"+std::to_string(pid)+".dump",pid);
+#endif
+    }
+    PerfMapWriter(const PerfMapWriter &)=delete;
+    PerfMapWriter &operator=(const PerfMapWriter &)=delete;
+    ~PerfMapWriter() {
+#ifdef __linux__
+        if(map_file!=nullptr) fclose(map_file);
+        if(jit_file!=nullptr){
+            writeRecordHeader(JIT_CODE_CLOSE,sizeof(RecordHeader));
+            if(marker!=MAP_FAILED) munmap(marker,marker_size);
+            fclose(jit_file);
+        }
+#endif
+    }
+
+    // 模块被映射到code处，重新加载时以新的地址再次调用，perf使用最后一次的记录
+    void moduleLoaded(const char *name,const void *code,size_t size) {
+#ifdef __linux__
+        if(size==0) return;
+        if(map_file!=nullptr){
+            fprintf(map_file,"%zx %zx %s\n",(size_t)code,size,name);
+            fflush(map_file); // perf在进程结束后才读取，但进程可能异常结束
+        }
+        if(jit_file!=nullptr){
+            size_t name_size=strlen(name)+1;
+            CodeLoad load;
+            load.pid=(uint32_t)getpid();
+            load.tid=(uint32_t)syscall(SYS_gettid);
+            load.vma=load.code_addr=(uint64_t)(size_t)code;
+            load.code_size=size;
+            load.code_index=code_index++;
+            writeRecordHeader(JIT_CODE_LOAD,sizeof(RecordHeader)+sizeof(load)+name_size+size);
+            fwrite(&load,sizeof(load),1,jit_file);
+            fwrite(name,1,name_size,jit_file);
+            fwrite(code,1,size,jit_file);
+            fflush(jit_file);
+        }
+#endif
+    }
+private:
+#ifdef __linux__
+    enum RecordType{JIT_CODE_LOAD=0,JIT_CODE_CLOSE=3};
+    struct FileHeader{
+        uint32_t magic,version,total_size,elf_mach,pad1,pid;
+        uint64_t timestamp,flags;
+    };
+    struct RecordHeader{
+        uint32_t id,total_size;
+        uint64_t timestamp;
+    };
+    struct CodeLoad{
+        uint32_t pid,tid;
+        uint64_t vma,code_addr,code_size,code_index;
+    };
+    static uint64_t timestamp() {
+        // perf record须使用-k mono，时间戳才能和采样对应
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        return (uint64_t)ts.tv_sec*1000000000ULL+ts.tv_nsec;
+    }
+    void openJitdump(const std::string &path,pid_t pid) {
+        jit_file=fopen(path.c_str(),"w+b");
+        if(jit_file==nullptr){
+            fprintf(stderr,"Warning: cannot create %s\n",path.c_str());
+            return;
+        }
+        FileHeader header;
+        header.magic=0x4A695444; // "JiTD"
+        header.version=1;
+        header.total_size=sizeof(header);
+#if defined(__x86_64__)
+        header.elf_mach=62; // EM_X86_64
+#elif defined(__i386__)
+        header.elf_mach=3; // EM_386
+#elif defined(__aarch64__)
+        header.elf_mach=183; // EM_AARCH64
+#else
+        header.elf_mach=0;
+#endif
+        header.pad1=0;header.pid=(uint32_t)pid;
+        header.timestamp=timestamp();header.flags=0;
+        fwrite(&header,sizeof(header),1,jit_file);
+        fflush(jit_file);
+        // perf inject通过这个可执行映射的MMAP事件找到jitdump文件
+        marker_size=(size_t)sysconf(_SC_PAGESIZE);
+        marker=mmap(nullptr,marker_size,PROT_READ|PROT_EXEC,MAP_PRIVATE,fileno(jit_file),0);
+        if(marker==MAP_FAILED) fprintf(stderr,"Warning: cannot map %s\n",path.c_str());
+    }
+    void writeRecordHeader(uint32_t id,size_t total_size) {
+        RecordHeader header{id,(uint32_t)total_size,timestamp()};
+        fwrite(&header,sizeof(header),1,jit_file);
+    }
+
+    FILE *map_file=nullptr,*jit_file=nullptr;
+    void *marker=MAP_FAILED;
+    size_t marker_size=0;
+    uint64_t code_index=0;
+#endif
+};
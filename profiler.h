@@ -0,0 +1,221 @@
+// 基于SIGPROF的采样分析器，将采样到的地址按已加载模块的范围归属到"模块名+偏移量"(仅POSIX)
+// 信号处理函数只做帧指针回溯，并把帧及其所在的模块写入预先申请的缓冲区，其他符号化在report时进行
+// 模块在采样时查找，之后被重新加载或释放的模块仍按采样时的范围归属
+#pragma once
+#include "constants.h"
+#include "module_index.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <csignal>
+#include <dlfcn.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#endif
+
+class SampleProfiler {
+public:
+    static const size_t MAX_DEPTH=64;
+    static const size_t BUFFER_SLOTS=(size_t)1<<22; // 32MB(64位)，按需分配物理页
+
+    SampleProfiler(const ModuleIndex &index):index(index),buffer(new void *[BUFFER_SLOTS]) {}
+    SampleProfiler(const SampleProfiler &)=delete;
+    SampleProfiler &operator=(const SampleProfiler &)=delete;
+    ~SampleProfiler() {
+        stop();
+        delete[] buffer;
+    }
+
+    static bool supported() {
+#if !defined(_WIN32) && defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+        return true;
+#else
+        return false;
+#endif
+    }
+    // 按进程消耗的CPU时间每秒采样hz次，同一时间只能有一个实例在采样
+    bool start(unsigned int hz) {
+#if !defined(_WIN32)
+        if(!supported() || active!=nullptr || hz==0) return false;
+        active=this;
+        struct sigaction action;
+        memset(&action,0,sizeof(action));
+        action.sa_sigaction=handler;
+        action.sa_flags=SA_SIGINFO|SA_RESTART; // 被打断的系统调用自动重新执行
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF,&action,&saved_action);
+        struct itimerval timer;
+        timer.it_interval.tv_sec=0;
+        timer.it_interval.tv_usec=(hz>=1000000)?1:1000000/hz;
+        timer.it_value=timer.it_interval;
+        setitimer(ITIMER_PROF,&timer,nullptr);
+        return true;
+#else
+        return false;
+#endif
+    }
+    void stop() {
+#if !defined(_WIN32)
+        if(active!=this) return;
+        struct itimerval timer;
+        memset(&timer,0,sizeof(timer));
+        setitimer(ITIMER_PROF,&timer,nullptr);
+        sigaction(SIGPROF,&saved_action,nullptr);
+        active=nullptr;
+#endif
+    }
+    size_t sampleCount() const {return samples.load(std::memory_order_relaxed);}
+    size_t droppedCount() const {return dropped.load(std::memory_order_relaxed);}
+
+    // 输出火焰图使用的折叠栈(每行"根帧;...;叶帧 次数")，停止采样后调用
+    void writeFolded(FILE *out) const {
+        std::map<std::string,size_t> stacks;
+        std::unordered_map<void *,std::string> names;
+        forEachSample([&](const Frame *frames,size_t depth){
+            std::string stack;
+            for(size_t i=depth;i-->0;){ // frames[0]为叶帧
+                if(!stack.empty()) stack+=';';
+                stack+=frameName(frames[i],names);
+            }
+            stacks[stack]++;
+        });
+        for(const auto &[stack,count]:stacks)
+            fprintf(out,"%s %zu\n",stack.c_str(),count);
+    }
+    // 输出每个模块的采样数，以及叶帧位于模块中的采样按偏移量的分布，停止采样后调用
+    void writeHistogram(FILE *out,size_t top_offsets=10) const {
+        struct ModuleSamples{
+            size_t self=0,total=0;
+            std::map<size_t,size_t> offsets; // 偏移量到叶帧的采样数
+        };
+        std::map<std::string,ModuleSamples> modules;
+        size_t total=0;
+        forEachSample([&](const Frame *frames,size_t depth){
+            total++;
+            const char *seen[MAX_DEPTH];size_t seen_count=0; // 递归调用时每个模块只计一次
+            for(size_t i=0;i<depth;i++){
+                const ModuleRange *range=frames[i].range;
+                if(range==nullptr) continue;
+                ModuleSamples &module=modules[range->name];
+                if(i==0){
+                    module.self++;
+                    module.offsets[(size_t)frames[i].address-range->start]++;
+                }
+                if(std::find(seen,seen+seen_count,range->name)==seen+seen_count){
+                    seen[seen_count++]=range->name;
+                    module.total++;
+                }
+            }
+        });
+        fprintf(out,"Profile: %zu samples (%zu dropped)\n",total,droppedCount());
+        std::vector<std::pair<std::string,const ModuleSamples *>> sorted;
+        for(const auto &[name,module]:modules) sorted.emplace_back(name,&module);
+        std::sort(sorted.begin(),sorted.end(),[](const auto &a,const auto &b){
+            return a.second->total>b.second->total;
+        });
+        for(const auto &[name,module]:sorted){
+            fprintf(out,"%s%s: %zu self, %zu total (%.1f%%)\n",name.c_str(),FILEEXT,
+                    module->self,module->total,total?100.0*module->total/total:0.0);
+            std::vector<std::pair<size_t,size_t>> offsets(module->offsets.begin(),module->offsets.end());
+            std::sort(offsets.begin(),offsets.end(),[](const auto &a,const auto &b){
+                return a.second>b.second;
+            });
+            if(offsets.size()>top_offsets) offsets.resize(top_offsets);
+            for(const auto &[offset,count]:offsets)
+                fprintf(out,"    +0x%zx %zu\n",offset,count);
+        }
+    }
+private:
+    struct Frame{
+        void *address;
+        const ModuleRange *range; // 采样时所在的模块，ModuleIndex保留旧的快照，在整个运行期间有效
+    };
+    static const size_t FRAME_SLOTS=sizeof(Frame)/sizeof(void *);
+    // 每个采样在缓冲区中的格式: 帧数 | 帧0(叶帧) | 帧1 | ...
+    template<typename Func>
+    void forEachSample(Func func) const {
+        size_t end=std::min(used.load(std::memory_order_acquire),BUFFER_SLOTS);
+        for(size_t pos=0;pos<end;){
+            size_t depth=(size_t)buffer[pos];
+            if(depth==0 || pos+1+depth*FRAME_SLOTS>end) break;
+            func((const Frame *)(buffer+pos+1),depth);
+            pos+=1+depth*FRAME_SLOTS;
+        }
+    }
+    std::string frameName(const Frame &frame,std::unordered_map<void *,std::string> &names) const {
+        if(frame.range!=nullptr) return frame.range->name; // 一个bin文件只包含一个函数
+        void *address=frame.address;
+        auto it=names.find(address);
+        if(it!=names.end()) return it->second;
+        std::string name="[unknown]";
+#if !defined(_WIN32)
+        Dl_info info;
+        if(dladdr(address,&info)!=0){
+            if(info.dli_sname!=nullptr) name=info.dli_sname;
+            else{ // 没有导出的符号，只显示所在的可执行文件或动态库
+                const char *base=strrchr(info.dli_fname,'/');
+                name=std::string("[")+(base?base+1:info.dli_fname)+"]";
+            }
+        }
+#endif
+        names[address]=name;
+        return name;
+    }
+#if !defined(_WIN32)
+    static void handler(int,siginfo_t *,void *ucontext) {
+        SampleProfiler *profiler=active;
+        if(profiler==nullptr) return;
+        int saved_errno=errno;
+        void *addresses[MAX_DEPTH];size_t depth=0;
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+        const mcontext_t &context=((ucontext_t *)ucontext)->uc_mcontext;
+#ifdef __x86_64__
+        void *pc=(void *)context.gregs[REG_RIP],*fp=(void *)context.gregs[REG_RBP];
+        void *sp=(void *)context.gregs[REG_RSP];
+#else
+        void *pc=(void *)context.gregs[REG_EIP],*fp=(void *)context.gregs[REG_EBP];
+        void *sp=(void *)context.gregs[REG_ESP];
+#endif
+        // 栈范围未知的线程不回溯，避免访问无效的帧指针；
+        // 采样落在没有建立帧的函数(如strlen)中时，从帧指针回溯会跳过调用它的模块，由栈顶补上
+        if(stack_bounds.high!=SIZE_MAX)
+            depth=unwindSignalContext(profiler->index,addresses,MAX_DEPTH,fp,pc,sp);
+        else addresses[depth++]=pc;
+#endif
+        Frame frames[MAX_DEPTH];
+        for(size_t i=0;i<depth;i++) // 在采样时查找模块，find不加锁、不申请内存
+            frames[i]=Frame{addresses[i],profiler->index.find((size_t)addresses[i])};
+        profiler->record(frames,depth);
+        errno=saved_errno;
+    }
+#endif
+    void record(const Frame *frames,size_t depth) {
+        if(depth==0) return;
+        size_t slots=1+depth*FRAME_SLOTS;
+        size_t pos=used.fetch_add(slots,std::memory_order_relaxed);
+        if(pos+slots>BUFFER_SLOTS){ // 缓冲区已满，之后的采样都丢弃
+            if(pos<BUFFER_SLOTS) buffer[pos]=nullptr; // 帧数为0，forEachSample在此结束
+            dropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        memcpy(buffer+pos+1,frames,depth*sizeof(Frame));
+        buffer[pos]=(void *)depth;
+        samples.fetch_add(1,std::memory_order_release);
+    }
+
+    const ModuleIndex &index;
+    void **buffer;
+    std::atomic<size_t> used{0},samples{0},dropped{0};
+    static inline SampleProfiler *volatile active=nullptr;
+#if !defined(_WIN32)
+    struct sigaction saved_action;
+#endif
+};
@@ -10,6 +10,11 @@
 #include <csetjmp>
 #include <unistd.h>
 #include "constants.h"
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/stat.h> // mkdir
+inline int *_errno(){return &errno;} // 和msvcrt的_errno相同，返回当前线程的errno的地址
+#endif
 
 struct RuntimeEnv {
     RuntimeVersion version;
@@ -293,11 +298,11 @@ struct RuntimeEnv {
     decltype(::copysignf) *copysignf;
     decltype(::copysignl) *copysignl;
     decltype(::strdup) *strdup;
-    decltype(::strchr) *strchr;
-    decltype(::strrchr) *strrchr;
-    decltype(::strpbrk) *strpbrk;
-    decltype(::strstr) *strstr;
-    decltype(::memchr) *memchr;
+    char *(*strchr)(const char *str,int ch);
+    char *(*strrchr)(const char *str,int ch);
+    char *(*strpbrk)(const char *dest,const char *breakset);
+    char *(*strstr)(const char *str,const char *substr);
+    void *(*memchr)(const void *ptr,int ch,size_t count);
     decltype(::memccpy) *memccpy;
     decltype(::access) *access;
     decltype(::chdir) *chdir;
@@ -320,6 +325,27 @@ struct RuntimeEnv {
     decltype(::getopt) *getopt;
     decltype(::ftruncate) *ftruncate;
     decltype(::lseek) *lseek;
+    int (*importModule)(const char *,int *);
+    void* (*getFuncById)(int);
+    int (*getModuleHandle)(const char *);
+    int (*reloadModule)(const char *);
+    void (*quiescentState)();
+    void (*registerThread)();
+    void (*unregisterThread)();
+    int (*guardedCall)(int (*)(void *),void *);
+    void* (*spawn)(int (*)(void *),void *);
+    int (*join)(void *);
+    int (*parallelFor)(long long,long long,long long,void (*)(long long,long long,void *),void *);
+    int (*ioSubmit)(const IoRequest *,int);
+    int (*ioWait)(IoCompletion *,int,int);
+    int (*fileno)(FILE *);
+    size_t (*getStats)(RuntimeStats *,size_t);
+    void* (*arenaCreate)(size_t,int);
+    void* (*arenaAlloc)(void *,size_t);
+    void (*arenaReset)(void *);
+    void (*arenaDestroy)(void *);
+    size_t (*getModuleMemory)(const char *,ModuleMemoryStats *,size_t);
+    void* (*memmem)(const void *,size_t,const void *,size_t);
     RuntimeEnv(){
         malloc=std::malloc;
         calloc=std::calloc;
@@ -590,11 +616,11 @@ struct RuntimeEnv {
         copysignf=::copysignf;
         copysignl=::copysignl;
         strdup=::strdup;
-        strchr=::strchr;
-        strrchr=::strrchr;
-        strpbrk=::strpbrk;
-        strstr=::strstr;
-        memchr=::memchr;
+        strchr=[](const char *str,int ch){return (char *)::strchr(str,ch);};
+        strrchr=[](const char *str,int ch){return (char *)::strrchr(str,ch);};
+        strpbrk=[](const char *dest,const char *breakset){return (char *)::strpbrk(dest,breakset);};
+        strstr=[](const char *str,const char *substr){return (char *)::strstr(str,substr);};
+        memchr=[](const void *ptr,int ch,size_t count){return (void *)::memchr(ptr,ch,count);};
         memccpy=::memccpy;
         access=::access;
         chdir=::chdir;
@@ -624,4 +650,4 @@ struct RuntimeEnv {
 #include <unordered_map>
 #include <utility>
 
-static std::unordered_map<std::string,std::pair<void *,size_t>> imported_funcs;
+static std::unordered_map<std::string,ModuleInfo> imported_funcs;
@@ -1,4 +1,4 @@
-import sys
+import sys,os
 def extract_funcs():
     # 备用函数，解析粘贴的cppreference文档中的标识符
     lines=sys.stdin.readlines()
@@ -25,16 +25,37 @@ funcs.extend(['fgetc', 'getc', 'fgets', 'fputc', 'putc', 'fputs', 'getchar', 'pu
 direct_funcs.extend(['abs', 'labs', 'llabs', 'div', 'ldiv', 'lldiv', 'fabs', 'fabsf', 'fabsl', 'fmod', 'fmodf', 'fmodl', 'remainder', 'remainderf', 'remainderl', 'remquo', 'remquof', 'remquol', 'fma', 'fmaf', 'fmal', 'fmax', 'fmaxf', 'fmaxl', 'fmin', 'fminf', 'fminl', 'fdim', 'fdimf', 'fdiml', 'exp', 'expf', 'expl', 'exp2', 'exp2f', 'exp2l', 'expm1', 'expm1f', 'expm1l', 'log', 'logf', 'logl', 'log10', 'log10f', 'log10l', 'log2', 'log2f', 'log2l', 'log1p', 'log1pf', 'log1pl', 'pow', 'powf', 'powl', 'sqrt', 'sqrtf', 'sqrtl', 'cbrt', 'cbrtf', 'cbrtl', 'hypot', 'hypotf', 'hypotl', 'sin', 'sinf', 'sinl', 'cos', 'cosf', 'cosl', 'tan', 'tanf', 'tanl', 'asin', 'asinf', 'asinl', 'acos', 'acosf', 'acosl', 'atan', 'atanf', 'atanl', 'atan2', 'atan2f', 'atan2l', 'sinh', 'sinhf', 'sinhl', 'cosh', 'coshf', 'coshl', 'tanh', 'tanhf', 'tanhl', 'asinh', 'asinhf', 'asinhl', 'acosh', 'acoshf', 'acoshl', 'atanh', 'atanhf', 'atanhl', 'erf', 'erff', 'erfl', 'erfc', 'erfcf', 'erfcl', 'tgamma', 'tgammaf', 'tgammal', 'lgamma', 'lgammaf', 'lgammal', 'ceil', 'ceilf', 'ceill', 'floor', 'floorf', 'floorl', 'trunc', 'truncf', 'truncl', 'round', 'roundf', 'roundl', 'lround', 'lroundf', 'lroundl', 'llround', 'llroundf', 'llroundl', 'nearbyint', 'nearbyintf', 'nearbyintl', 'rint', 'rintf', 'rintl', 'lrint', 'lrintf', 'lrintl', 'llrint', 'llrintf', 'llrintl', 'frexp', 'frexpf', 'frexpl', 'ldexp', 'ldexpf', 'ldexpl', 'modf', 'modff', 'modfl', 'scalbn', 'scalbnf', 'scalbnl', 'scalbln', 'scalblnf', 'scalblnl', 'ilogb', 'ilogbf', 'ilogbl', 'logb', 'logbf', 'logbl', 'nextafter', 'nextafterf', 'nextafterl', 'nexttoward', 'nexttowardf', 'nexttowardl', 'copysign', 'copysignf', 'copysignl'])
 funcs.extend(['atof', 'atoi', 'atol', 'atoll', 'strtol', 'strtoll', 'strtoul', 'strtoull', 'strtof', 'strtod', 'strtold', 'strcpy', 'strncpy', 'strcat', 'strncat', 'strxfrm', 'strlen', 'strcmp', 'strncmp', 'strcoll', 'strspn', 'strcspn', 'strtok', 'memcmp', 'memset', 'memcpy', 'memmove', 'strerror'])
 direct_funcs.extend(['strdup', 'strchr', 'strrchr', 'strpbrk', 'strstr', 'memchr', 'memccpy'])
+# glibc等在C++中提供const重载的函数，使用C的函数签名，通过lambda转发: 函数名 -> (返回类型, 参数, 调用)
+cstyle_funcs={
+    'strchr': ('char *', 'const char *str,int ch', '(char *)::strchr(str,ch)'),
+    'strrchr': ('char *', 'const char *str,int ch', '(char *)::strrchr(str,ch)'),
+    'strpbrk': ('char *', 'const char *dest,const char *breakset', '(char *)::strpbrk(dest,breakset)'),
+    'strstr': ('char *', 'const char *str,const char *substr', '(char *)::strstr(str,substr)'),
+    'memchr': ('void *', 'const void *ptr,int ch,size_t count', '(void *)::memchr(ptr,ch,count)'),
+}
 funcs.extend(['isalnum', 'isalpha', 'islower', 'isupper', 'isdigit', 'isxdigit', 'iscntrl', 'isgraph', 'isspace', 'isblank', 'isprint', 'ispunct', 'tolower', 'toupper'])
 funcs.extend(['fopen', 'freopen', 'fclose', 'fflush', 'setbuf', 'setvbuf', 'fread', 'fwrite'])
 funcs.extend(['difftime', 'time', 'clock', 'asctime',  'ctime', 'strftime', 'gmtime', 'localtime', 'mktime'])
 funcs.extend(['system','exit','raise','signal','longjmp'])
 direct_funcs.extend(['access', 'chdir', 'getcwd', 'mkdir', 'rmdir', 'rename', 'unlink', 'close', 'dup', 'dup2', 'read', 'write', 'execve', 'getpid', 'sleep', 'usleep', 'getenv', 'isatty', 'getopt', 'ftruncate', 'lseek']) # windows可用的部分unistd.h函数
 
+# 运行时新增的函数，放在结构体末尾，保持已编译的bin文件中其他成员的偏移量不变
+ext_fields=[]
+ext_fields.extend(['int (*importModule)(const char *,int *)', 'void* (*getFuncById)(int)', 'int (*getModuleHandle)(const char *)'])
+ext_fields.extend(['int (*reloadModule)(const char *)'])
+ext_fields.extend(['void (*quiescentState)()'])
+ext_fields.extend(['void (*registerThread)()', 'void (*unregisterThread)()', 'int (*guardedCall)(int (*)(void *),void *)'])
+ext_fields.extend(['void* (*spawn)(int (*)(void *),void *)', 'int (*join)(void *)', 'int (*parallelFor)(long long,long long,long long,void (*)(long long,long long,void *),void *)'])
+ext_fields.extend(['int (*ioSubmit)(const IoRequest *,int)', 'int (*ioWait)(IoCompletion *,int,int)', 'int (*fileno)(FILE *)'])
+ext_fields.extend(['size_t (*getStats)(RuntimeStats *,size_t)'])
+ext_fields.extend(['void* (*arenaCreate)(size_t,int)', 'void* (*arenaAlloc)(void *,size_t)', 'void (*arenaReset)(void *)', 'void (*arenaDestroy)(void *)'])
+ext_fields.extend(['size_t (*getModuleMemory)(const char *,ModuleMemoryStats *,size_t)'])
+ext_fields.extend(['void* (*memmem)(const void *,size_t,const void *,size_t)'])
+
 TAB=" "*4
 with open("runtime_env.h","w",encoding="utf-8") as f:
     print(f"""\
-// Generated by {__file__}, do NOT edit
+// Generated by {os.path.basename(__file__)}, do NOT edit
 #pragma once
 #include <cstdio>
 #include <cstring>
@@ -46,6 +67,11 @@ with open("runtime_env.h","w",encoding="utf-8") as f:
 #include <csetjmp>
 #include <unistd.h>
 #include "constants.h"
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/stat.h> // mkdir
+inline int *_errno(){{return &errno;}} // 和msvcrt的_errno相同，返回当前线程的errno的地址
+#endif
 
 struct RuntimeEnv {{
     RuntimeVersion version;
@@ -64,12 +90,19 @@ struct RuntimeEnv {{
     for func in funcs:
         print(TAB+f"decltype(std::{func}) *{func};",file=f)
     for func in direct_funcs:
-        print(TAB+f"decltype(::{func}) *{func};",file=f)
+        if func in cstyle_funcs:
+            result,params,_=cstyle_funcs[func]
+            print(TAB+f"{result}(*{func})({params});",file=f)
+        else:
+            print(TAB+f"decltype(::{func}) *{func};",file=f)
+    for field in ext_fields:
+        print(TAB+field+";",file=f)
     print("""\
     RuntimeEnv(){\n"""+TAB*2,end="",file=f)
     print(("\n"+TAB*2).join(f"{func}=std::{func};" for func in funcs),file=f)
     print(TAB*2,end="",file=f)
-    print(("\n"+TAB*2).join(f"{func}=::{func};" for func in direct_funcs),file=f)
+    print(("\n"+TAB*2).join(f"{func}=[]({cstyle_funcs[func][1]}){{return {cstyle_funcs[func][2]};}};"
+                            if func in cstyle_funcs else f"{func}=::{func};" for func in direct_funcs),file=f)
     print(TAB+"}",file=f)
     print("""\
 };
@@ -78,4 +111,55 @@ struct RuntimeEnv {{
 #include <unordered_map>
 #include <utility>
 
-static std::unordered_map<std::string,std::pair<void *,size_t>> imported_funcs;""",file=f)
\ No newline at end of file
+static std::unordered_map<std::string,ModuleInfo> imported_funcs;""",file=f)
+# --trace-env使用的转发函数，每个RuntimeEnv的函数指针对应一个，按ENV_TRACE_NAMES中的下标统计
+head_fields=['getFunc', 'import', 'getLibraryFunc', 'freeLibrary', 'debugModuleInfo', 'getstdin', 'getstdout', 'getstderr', 'stackTrace', 'abort']
+noreturn_funcs=['exit', 'longjmp', 'abort'] # 不返回的函数只计数，不计时
+variadic_funcs={ # 可变参数的函数通过对应的v*函数转发(声明为noexcept，以便赋给两种函数指针): 函数名 -> (v*函数名, 固定的参数)
+    'scanf': ('vscanf', ['const char *format']),
+    'fscanf': ('vfscanf', ['FILE *stream', 'const char *format']),
+    'sscanf': ('vsscanf', ['const char *buffer', 'const char *format']),
+    'printf': ('vprintf', ['const char *format']),
+    'fprintf': ('vfprintf', ['FILE *stream', 'const char *format']),
+    'sprintf': ('vsprintf', ['char *buffer', 'const char *format']),
+    'snprintf': ('vsnprintf', ['char *buffer', 'size_t size', 'const char *format']),
+}
+import re
+ext_names=[re.search(r"\(\*(\w+)\)",field).group(1) for field in ext_fields]
+trace_names=head_fields+funcs+direct_funcs+ext_names
+with open("runtime_env_trace.h","w",encoding="utf-8") as f:
+    print(f"""\
+// Generated by {os.path.basename(__file__)}, do NOT edit
+#pragma once
+#include <cstdarg>
+#include "runtime_env.h"
+#include "env_trace.h"
+
+const int ENV_TRACE_COUNT={len(trace_names)};
+const char *const ENV_TRACE_NAMES[ENV_TRACE_COUNT]={{""",file=f)
+    for i in range(0,len(trace_names),8):
+        print(TAB+",".join(f'"{name}"' for name in trace_names[i:i+8])+",",file=f)
+    print("};",file=f)
+    for name,(vfunc,params) in variadic_funcs.items():
+        index=trace_names.index(name)
+        args=",".join(re.search(r"(\w+)$",param).group(1) for param in params)
+        print(f"""\
+inline int envTrace_{name}({",".join(params)},...) noexcept{{
+    EnvTraceScope scope({index},__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::{vfunc}({args},args);
+    va_end(args);
+    return result;
+}}""",file=f)
+    print("""\
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes" // 函数类型上的nonnull等属性不影响转发
+inline void installEnvTrace(RuntimeEnv *env){
+    // 在initRuntimeEnv之后调用，将每个函数指针替换为转发函数""",file=f)
+    for index,name in enumerate(trace_names):
+        if name in variadic_funcs:
+            print(TAB+f"env->{name}=envTrace_{name};",file=f)
+        else:
+            timed="" if name not in noreturn_funcs else ",false"
+            print(TAB+f"env->{name}=EnvThunk<{index},decltype(env->{name}){timed}>::install(env->{name});",file=f)
+    print("}\n#pragma GCC diagnostic pop",file=f)
@@ -0,0 +1,432 @@
+// Generated by runtime_env_generator.py, do NOT edit
+#pragma once
+#include <cstdarg>
+#include "runtime_env.h"
+#include "env_trace.h"
+
+const int ENV_TRACE_COUNT=327;
+const char *const ENV_TRACE_NAMES[ENV_TRACE_COUNT]={
+    "getFunc","import","getLibraryFunc","freeLibrary","debugModuleInfo","getstdin","getstdout","getstderr",
+    "stackTrace","abort","malloc","calloc","realloc","free","scanf","fscanf",
+    "sscanf","vscanf","vfscanf","vsscanf","printf","fprintf","sprintf","snprintf",
+    "vprintf","vfprintf","vsprintf","vsnprintf","perror","fgetc","getc","fgets",
+    "fputc","putc","fputs","getchar","putchar","puts","ungetc","atof",
+    "atoi","atol","atoll","strtol","strtoll","strtoul","strtoull","strtof",
+    "strtod","strtold","strcpy","strncpy","strcat","strncat","strxfrm","strlen",
+    "strcmp","strncmp","strcoll","strspn","strcspn","strtok","memcmp","memset",
+    "memcpy","memmove","strerror","isalnum","isalpha","islower","isupper","isdigit",
+    "isxdigit","iscntrl","isgraph","isspace","isblank","isprint","ispunct","tolower",
+    "toupper","fopen","freopen","fclose","fflush","setbuf","setvbuf","fread",
+    "fwrite","difftime","time","clock","asctime","ctime","strftime","gmtime",
+    "localtime","mktime","system","exit","raise","signal","longjmp","_errno",
+    "abs","labs","llabs","div","ldiv","lldiv","fabs","fabsf",
+    "fabsl","fmod","fmodf","fmodl","remainder","remainderf","remainderl","remquo",
+    "remquof","remquol","fma","fmaf","fmal","fmax","fmaxf","fmaxl",
+    "fmin","fminf","fminl","fdim","fdimf","fdiml","exp","expf",
+    "expl","exp2","exp2f","exp2l","expm1","expm1f","expm1l","log",
+    "logf","logl","log10","log10f","log10l","log2","log2f","log2l",
+    "log1p","log1pf","log1pl","pow","powf","powl","sqrt","sqrtf",
+    "sqrtl","cbrt","cbrtf","cbrtl","hypot","hypotf","hypotl","sin",
+    "sinf","sinl","cos","cosf","cosl","tan","tanf","tanl",
+    "asin","asinf","asinl","acos","acosf","acosl","atan","atanf",
+    "atanl","atan2","atan2f","atan2l","sinh","sinhf","sinhl","cosh",
+    "coshf","coshl","tanh","tanhf","tanhl","asinh","asinhf","asinhl",
+    "acosh","acoshf","acoshl","atanh","atanhf","atanhl","erf","erff",
+    "erfl","erfc","erfcf","erfcl","tgamma","tgammaf","tgammal","lgamma",
+    "lgammaf","lgammal","ceil","ceilf","ceill","floor","floorf","floorl",
+    "trunc","truncf","truncl","round","roundf","roundl","lround","lroundf",
+    "lroundl","llround","llroundf","llroundl","nearbyint","nearbyintf","nearbyintl","rint",
+    "rintf","rintl","lrint","lrintf","lrintl","llrint","llrintf","llrintl",
+    "frexp","frexpf","frexpl","ldexp","ldexpf","ldexpl","modf","modff",
+    "modfl","scalbn","scalbnf","scalbnl","scalbln","scalblnf","scalblnl","ilogb",
+    "ilogbf","ilogbl","logb","logbf","logbl","nextafter","nextafterf","nextafterl",
+    "nexttoward","nexttowardf","nexttowardl","copysign","copysignf","copysignl","strdup","strchr",
+    "strrchr","strpbrk","strstr","memchr","memccpy","access","chdir","getcwd",
+    "mkdir","rmdir","rename","unlink","close","dup","dup2","read",
+    "write","execve","getpid","sleep","usleep","getenv","isatty","getopt",
+    "ftruncate","lseek","importModule","getFuncById","getModuleHandle","reloadModule","quiescentState","registerThread",
+    "unregisterThread","guardedCall","spawn","join","parallelFor","ioSubmit","ioWait","fileno",
+    "getStats","arenaCreate","arenaAlloc","arenaReset","arenaDestroy","getModuleMemory","memmem",
+};
+inline int envTrace_scanf(const char *format,...) noexcept{
+    EnvTraceScope scope(14,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vscanf(format,args);
+    va_end(args);
+    return result;
+}
+inline int envTrace_fscanf(FILE *stream,const char *format,...) noexcept{
+    EnvTraceScope scope(15,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vfscanf(stream,format,args);
+    va_end(args);
+    return result;
+}
+inline int envTrace_sscanf(const char *buffer,const char *format,...) noexcept{
+    EnvTraceScope scope(16,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vsscanf(buffer,format,args);
+    va_end(args);
+    return result;
+}
+inline int envTrace_printf(const char *format,...) noexcept{
+    EnvTraceScope scope(20,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vprintf(format,args);
+    va_end(args);
+    return result;
+}
+inline int envTrace_fprintf(FILE *stream,const char *format,...) noexcept{
+    EnvTraceScope scope(21,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vfprintf(stream,format,args);
+    va_end(args);
+    return result;
+}
+inline int envTrace_sprintf(char *buffer,const char *format,...) noexcept{
+    EnvTraceScope scope(22,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vsprintf(buffer,format,args);
+    va_end(args);
+    return result;
+}
+inline int envTrace_snprintf(char *buffer,size_t size,const char *format,...) noexcept{
+    EnvTraceScope scope(23,__builtin_return_address(0));
+    va_list args;va_start(args,format);
+    int result=std::vsnprintf(buffer,size,format,args);
+    va_end(args);
+    return result;
+}
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes" // 函数类型上的nonnull等属性不影响转发
+inline void installEnvTrace(RuntimeEnv *env){
+    // 在initRuntimeEnv之后调用，将每个函数指针替换为转发函数
+    env->getFunc=EnvThunk<0,decltype(env->getFunc)>::install(env->getFunc);
+    env->import=EnvThunk<1,decltype(env->import)>::install(env->import);
+    env->getLibraryFunc=EnvThunk<2,decltype(env->getLibraryFunc)>::install(env->getLibraryFunc);
+    env->freeLibrary=EnvThunk<3,decltype(env->freeLibrary)>::install(env->freeLibrary);
+    env->debugModuleInfo=EnvThunk<4,decltype(env->debugModuleInfo)>::install(env->debugModuleInfo);
+    env->getstdin=EnvThunk<5,decltype(env->getstdin)>::install(env->getstdin);
+    env->getstdout=EnvThunk<6,decltype(env->getstdout)>::install(env->getstdout);
+    env->getstderr=EnvThunk<7,decltype(env->getstderr)>::install(env->getstderr);
+    env->stackTrace=EnvThunk<8,decltype(env->stackTrace)>::install(env->stackTrace);
+    env->abort=EnvThunk<9,decltype(env->abort),false>::install(env->abort);
+    env->malloc=EnvThunk<10,decltype(env->malloc)>::install(env->malloc);
+    env->calloc=EnvThunk<11,decltype(env->calloc)>::install(env->calloc);
+    env->realloc=EnvThunk<12,decltype(env->realloc)>::install(env->realloc);
+    env->free=EnvThunk<13,decltype(env->free)>::install(env->free);
+    env->scanf=envTrace_scanf;
+    env->fscanf=envTrace_fscanf;
+    env->sscanf=envTrace_sscanf;
+    env->vscanf=EnvThunk<17,decltype(env->vscanf)>::install(env->vscanf);
+    env->vfscanf=EnvThunk<18,decltype(env->vfscanf)>::install(env->vfscanf);
+    env->vsscanf=EnvThunk<19,decltype(env->vsscanf)>::install(env->vsscanf);
+    env->printf=envTrace_printf;
+    env->fprintf=envTrace_fprintf;
+    env->sprintf=envTrace_sprintf;
+    env->snprintf=envTrace_snprintf;
+    env->vprintf=EnvThunk<24,decltype(env->vprintf)>::install(env->vprintf);
+    env->vfprintf=EnvThunk<25,decltype(env->vfprintf)>::install(env->vfprintf);
+    env->vsprintf=EnvThunk<26,decltype(env->vsprintf)>::install(env->vsprintf);
+    env->vsnprintf=EnvThunk<27,decltype(env->vsnprintf)>::install(env->vsnprintf);
+    env->perror=EnvThunk<28,decltype(env->perror)>::install(env->perror);
+    env->fgetc=EnvThunk<29,decltype(env->fgetc)>::install(env->fgetc);
+    env->getc=EnvThunk<30,decltype(env->getc)>::install(env->getc);
+    env->fgets=EnvThunk<31,decltype(env->fgets)>::install(env->fgets);
+    env->fputc=EnvThunk<32,decltype(env->fputc)>::install(env->fputc);
+    env->putc=EnvThunk<33,decltype(env->putc)>::install(env->putc);
+    env->fputs=EnvThunk<34,decltype(env->fputs)>::install(env->fputs);
+    env->getchar=EnvThunk<35,decltype(env->getchar)>::install(env->getchar);
+    env->putchar=EnvThunk<36,decltype(env->putchar)>::install(env->putchar);
+    env->puts=EnvThunk<37,decltype(env->puts)>::install(env->puts);
+    env->ungetc=EnvThunk<38,decltype(env->ungetc)>::install(env->ungetc);
+    env->atof=EnvThunk<39,decltype(env->atof)>::install(env->atof);
+    env->atoi=EnvThunk<40,decltype(env->atoi)>::install(env->atoi);
+    env->atol=EnvThunk<41,decltype(env->atol)>::install(env->atol);
+    env->atoll=EnvThunk<42,decltype(env->atoll)>::install(env->atoll);
+    env->strtol=EnvThunk<43,decltype(env->strtol)>::install(env->strtol);
+    env->strtoll=EnvThunk<44,decltype(env->strtoll)>::install(env->strtoll);
+    env->strtoul=EnvThunk<45,decltype(env->strtoul)>::install(env->strtoul);
+    env->strtoull=EnvThunk<46,decltype(env->strtoull)>::install(env->strtoull);
+    env->strtof=EnvThunk<47,decltype(env->strtof)>::install(env->strtof);
+    env->strtod=EnvThunk<48,decltype(env->strtod)>::install(env->strtod);
+    env->strtold=EnvThunk<49,decltype(env->strtold)>::install(env->strtold);
+    env->strcpy=EnvThunk<50,decltype(env->strcpy)>::install(env->strcpy);
+    env->strncpy=EnvThunk<51,decltype(env->strncpy)>::install(env->strncpy);
+    env->strcat=EnvThunk<52,decltype(env->strcat)>::install(env->strcat);
+    env->strncat=EnvThunk<53,decltype(env->strncat)>::install(env->strncat);
+    env->strxfrm=EnvThunk<54,decltype(env->strxfrm)>::install(env->strxfrm);
+    env->strlen=EnvThunk<55,decltype(env->strlen)>::install(env->strlen);
+    env->strcmp=EnvThunk<56,decltype(env->strcmp)>::install(env->strcmp);
+    env->strncmp=EnvThunk<57,decltype(env->strncmp)>::install(env->strncmp);
+    env->strcoll=EnvThunk<58,decltype(env->strcoll)>::install(env->strcoll);
+    env->strspn=EnvThunk<59,decltype(env->strspn)>::install(env->strspn);
+    env->strcspn=EnvThunk<60,decltype(env->strcspn)>::install(env->strcspn);
+    env->strtok=EnvThunk<61,decltype(env->strtok)>::install(env->strtok);
+    env->memcmp=EnvThunk<62,decltype(env->memcmp)>::install(env->memcmp);
+    env->memset=EnvThunk<63,decltype(env->memset)>::install(env->memset);
+    env->memcpy=EnvThunk<64,decltype(env->memcpy)>::install(env->memcpy);
+    env->memmove=EnvThunk<65,decltype(env->memmove)>::install(env->memmove);
+    env->strerror=EnvThunk<66,decltype(env->strerror)>::install(env->strerror);
+    env->isalnum=EnvThunk<67,decltype(env->isalnum)>::install(env->isalnum);
+    env->isalpha=EnvThunk<68,decltype(env->isalpha)>::install(env->isalpha);
+    env->islower=EnvThunk<69,decltype(env->islower)>::install(env->islower);
+    env->isupper=EnvThunk<70,decltype(env->isupper)>::install(env->isupper);
+    env->isdigit=EnvThunk<71,decltype(env->isdigit)>::install(env->isdigit);
+    env->isxdigit=EnvThunk<72,decltype(env->isxdigit)>::install(env->isxdigit);
+    env->iscntrl=EnvThunk<73,decltype(env->iscntrl)>::install(env->iscntrl);
+    env->isgraph=EnvThunk<74,decltype(env->isgraph)>::install(env->isgraph);
+    env->isspace=EnvThunk<75,decltype(env->isspace)>::install(env->isspace);
+    env->isblank=EnvThunk<76,decltype(env->isblank)>::install(env->isblank);
+    env->isprint=EnvThunk<77,decltype(env->isprint)>::install(env->isprint);
+    env->ispunct=EnvThunk<78,decltype(env->ispunct)>::install(env->ispunct);
+    env->tolower=EnvThunk<79,decltype(env->tolower)>::install(env->tolower);
+    env->toupper=EnvThunk<80,decltype(env->toupper)>::install(env->toupper);
+    env->fopen=EnvThunk<81,decltype(env->fopen)>::install(env->fopen);
+    env->freopen=EnvThunk<82,decltype(env->freopen)>::install(env->freopen);
+    env->fclose=EnvThunk<83,decltype(env->fclose)>::install(env->fclose);
+    env->fflush=EnvThunk<84,decltype(env->fflush)>::install(env->fflush);
+    env->setbuf=EnvThunk<85,decltype(env->setbuf)>::install(env->setbuf);
+    env->setvbuf=EnvThunk<86,decltype(env->setvbuf)>::install(env->setvbuf);
+    env->fread=EnvThunk<87,decltype(env->fread)>::install(env->fread);
+    env->fwrite=EnvThunk<88,decltype(env->fwrite)>::install(env->fwrite);
+    env->difftime=EnvThunk<89,decltype(env->difftime)>::install(env->difftime);
+    env->time=EnvThunk<90,decltype(env->time)>::install(env->time);
+    env->clock=EnvThunk<91,decltype(env->clock)>::install(env->clock);
+    env->asctime=EnvThunk<92,decltype(env->asctime)>::install(env->asctime);
+    env->ctime=EnvThunk<93,decltype(env->ctime)>::install(env->ctime);
+    env->strftime=EnvThunk<94,decltype(env->strftime)>::install(env->strftime);
+    env->gmtime=EnvThunk<95,decltype(env->gmtime)>::install(env->gmtime);
+    env->localtime=EnvThunk<96,decltype(env->localtime)>::install(env->localtime);
+    env->mktime=EnvThunk<97,decltype(env->mktime)>::install(env->mktime);
+    env->system=EnvThunk<98,decltype(env->system)>::install(env->system);
+    env->exit=EnvThunk<99,decltype(env->exit),false>::install(env->exit);
+    env->raise=EnvThunk<100,decltype(env->raise)>::install(env->raise);
+    env->signal=EnvThunk<101,decltype(env->signal)>::install(env->signal);
+    env->longjmp=EnvThunk<102,decltype(env->longjmp),false>::install(env->longjmp);
+    env->_errno=EnvThunk<103,decltype(env->_errno)>::install(env->_errno);
+    env->abs=EnvThunk<104,decltype(env->abs)>::install(env->abs);
+    env->labs=EnvThunk<105,decltype(env->labs)>::install(env->labs);
+    env->llabs=EnvThunk<106,decltype(env->llabs)>::install(env->llabs);
+    env->div=EnvThunk<107,decltype(env->div)>::install(env->div);
+    env->ldiv=EnvThunk<108,decltype(env->ldiv)>::install(env->ldiv);
+    env->lldiv=EnvThunk<109,decltype(env->lldiv)>::install(env->lldiv);
+    env->fabs=EnvThunk<110,decltype(env->fabs)>::install(env->fabs);
+    env->fabsf=EnvThunk<111,decltype(env->fabsf)>::install(env->fabsf);
+    env->fabsl=EnvThunk<112,decltype(env->fabsl)>::install(env->fabsl);
+    env->fmod=EnvThunk<113,decltype(env->fmod)>::install(env->fmod);
+    env->fmodf=EnvThunk<114,decltype(env->fmodf)>::install(env->fmodf);
+    env->fmodl=EnvThunk<115,decltype(env->fmodl)>::install(env->fmodl);
+    env->remainder=EnvThunk<116,decltype(env->remainder)>::install(env->remainder);
+    env->remainderf=EnvThunk<117,decltype(env->remainderf)>::install(env->remainderf);
+    env->remainderl=EnvThunk<118,decltype(env->remainderl)>::install(env->remainderl);
+    env->remquo=EnvThunk<119,decltype(env->remquo)>::install(env->remquo);
+    env->remquof=EnvThunk<120,decltype(env->remquof)>::install(env->remquof);
+    env->remquol=EnvThunk<121,decltype(env->remquol)>::install(env->remquol);
+    env->fma=EnvThunk<122,decltype(env->fma)>::install(env->fma);
+    env->fmaf=EnvThunk<123,decltype(env->fmaf)>::install(env->fmaf);
+    env->fmal=EnvThunk<124,decltype(env->fmal)>::install(env->fmal);
+    env->fmax=EnvThunk<125,decltype(env->fmax)>::install(env->fmax);
+    env->fmaxf=EnvThunk<126,decltype(env->fmaxf)>::install(env->fmaxf);
+    env->fmaxl=EnvThunk<127,decltype(env->fmaxl)>::install(env->fmaxl);
+    env->fmin=EnvThunk<128,decltype(env->fmin)>::install(env->fmin);
+    env->fminf=EnvThunk<129,decltype(env->fminf)>::install(env->fminf);
+    env->fminl=EnvThunk<130,decltype(env->fminl)>::install(env->fminl);
+    env->fdim=EnvThunk<131,decltype(env->fdim)>::install(env->fdim);
+    env->fdimf=EnvThunk<132,decltype(env->fdimf)>::install(env->fdimf);
+    env->fdiml=EnvThunk<133,decltype(env->fdiml)>::install(env->fdiml);
+    env->exp=EnvThunk<134,decltype(env->exp)>::install(env->exp);
+    env->expf=EnvThunk<135,decltype(env->expf)>::install(env->expf);
+    env->expl=EnvThunk<136,decltype(env->expl)>::install(env->expl);
+    env->exp2=EnvThunk<137,decltype(env->exp2)>::install(env->exp2);
+    env->exp2f=EnvThunk<138,decltype(env->exp2f)>::install(env->exp2f);
+    env->exp2l=EnvThunk<139,decltype(env->exp2l)>::install(env->exp2l);
+    env->expm1=EnvThunk<140,decltype(env->expm1)>::install(env->expm1);
+    env->expm1f=EnvThunk<141,decltype(env->expm1f)>::install(env->expm1f);
+    env->expm1l=EnvThunk<142,decltype(env->expm1l)>::install(env->expm1l);
+    env->log=EnvThunk<143,decltype(env->log)>::install(env->log);
+    env->logf=EnvThunk<144,decltype(env->logf)>::install(env->logf);
+    env->logl=EnvThunk<145,decltype(env->logl)>::install(env->logl);
+    env->log10=EnvThunk<146,decltype(env->log10)>::install(env->log10);
+    env->log10f=EnvThunk<147,decltype(env->log10f)>::install(env->log10f);
+    env->log10l=EnvThunk<148,decltype(env->log10l)>::install(env->log10l);
+    env->log2=EnvThunk<149,decltype(env->log2)>::install(env->log2);
+    env->log2f=EnvThunk<150,decltype(env->log2f)>::install(env->log2f);
+    env->log2l=EnvThunk<151,decltype(env->log2l)>::install(env->log2l);
+    env->log1p=EnvThunk<152,decltype(env->log1p)>::install(env->log1p);
+    env->log1pf=EnvThunk<153,decltype(env->log1pf)>::install(env->log1pf);
+    env->log1pl=EnvThunk<154,decltype(env->log1pl)>::install(env->log1pl);
+    env->pow=EnvThunk<155,decltype(env->pow)>::install(env->pow);
+    env->powf=EnvThunk<156,decltype(env->powf)>::install(env->powf);
+    env->powl=EnvThunk<157,decltype(env->powl)>::install(env->powl);
+    env->sqrt=EnvThunk<158,decltype(env->sqrt)>::install(env->sqrt);
+    env->sqrtf=EnvThunk<159,decltype(env->sqrtf)>::install(env->sqrtf);
+    env->sqrtl=EnvThunk<160,decltype(env->sqrtl)>::install(env->sqrtl);
+    env->cbrt=EnvThunk<161,decltype(env->cbrt)>::install(env->cbrt);
+    env->cbrtf=EnvThunk<162,decltype(env->cbrtf)>::install(env->cbrtf);
+    env->cbrtl=EnvThunk<163,decltype(env->cbrtl)>::install(env->cbrtl);
+    env->hypot=EnvThunk<164,decltype(env->hypot)>::install(env->hypot);
+    env->hypotf=EnvThunk<165,decltype(env->hypotf)>::install(env->hypotf);
+    env->hypotl=EnvThunk<166,decltype(env->hypotl)>::install(env->hypotl);
+    env->sin=EnvThunk<167,decltype(env->sin)>::install(env->sin);
+    env->sinf=EnvThunk<168,decltype(env->sinf)>::install(env->sinf);
+    env->sinl=EnvThunk<169,decltype(env->sinl)>::install(env->sinl);
+    env->cos=EnvThunk<170,decltype(env->cos)>::install(env->cos);
+    env->cosf=EnvThunk<171,decltype(env->cosf)>::install(env->cosf);
+    env->cosl=EnvThunk<172,decltype(env->cosl)>::install(env->cosl);
+    env->tan=EnvThunk<173,decltype(env->tan)>::install(env->tan);
+    env->tanf=EnvThunk<174,decltype(env->tanf)>::install(env->tanf);
+    env->tanl=EnvThunk<175,decltype(env->tanl)>::install(env->tanl);
+    env->asin=EnvThunk<176,decltype(env->asin)>::install(env->asin);
+    env->asinf=EnvThunk<177,decltype(env->asinf)>::install(env->asinf);
+    env->asinl=EnvThunk<178,decltype(env->asinl)>::install(env->asinl);
+    env->acos=EnvThunk<179,decltype(env->acos)>::install(env->acos);
+    env->acosf=EnvThunk<180,decltype(env->acosf)>::install(env->acosf);
+    env->acosl=EnvThunk<181,decltype(env->acosl)>::install(env->acosl);
+    env->atan=EnvThunk<182,decltype(env->atan)>::install(env->atan);
+    env->atanf=EnvThunk<183,decltype(env->atanf)>::install(env->atanf);
+    env->atanl=EnvThunk<184,decltype(env->atanl)>::install(env->atanl);
+    env->atan2=EnvThunk<185,decltype(env->atan2)>::install(env->atan2);
+    env->atan2f=EnvThunk<186,decltype(env->atan2f)>::install(env->atan2f);
+    env->atan2l=EnvThunk<187,decltype(env->atan2l)>::install(env->atan2l);
+    env->sinh=EnvThunk<188,decltype(env->sinh)>::install(env->sinh);
+    env->sinhf=EnvThunk<189,decltype(env->sinhf)>::install(env->sinhf);
+    env->sinhl=EnvThunk<190,decltype(env->sinhl)>::install(env->sinhl);
+    env->cosh=EnvThunk<191,decltype(env->cosh)>::install(env->cosh);
+    env->coshf=EnvThunk<192,decltype(env->coshf)>::install(env->coshf);
+    env->coshl=EnvThunk<193,decltype(env->coshl)>::install(env->coshl);
+    env->tanh=EnvThunk<194,decltype(env->tanh)>::install(env->tanh);
+    env->tanhf=EnvThunk<195,decltype(env->tanhf)>::install(env->tanhf);
+    env->tanhl=EnvThunk<196,decltype(env->tanhl)>::install(env->tanhl);
+    env->asinh=EnvThunk<197,decltype(env->asinh)>::install(env->asinh);
+    env->asinhf=EnvThunk<198,decltype(env->asinhf)>::install(env->asinhf);
+    env->asinhl=EnvThunk<199,decltype(env->asinhl)>::install(env->asinhl);
+    env->acosh=EnvThunk<200,decltype(env->acosh)>::install(env->acosh);
+    env->acoshf=EnvThunk<201,decltype(env->acoshf)>::install(env->acoshf);
+    env->acoshl=EnvThunk<202,decltype(env->acoshl)>::install(env->acoshl);
+    env->atanh=EnvThunk<203,decltype(env->atanh)>::install(env->atanh);
+    env->atanhf=EnvThunk<204,decltype(env->atanhf)>::install(env->atanhf);
+    env->atanhl=EnvThunk<205,decltype(env->atanhl)>::install(env->atanhl);
+    env->erf=EnvThunk<206,decltype(env->erf)>::install(env->erf);
+    env->erff=EnvThunk<207,decltype(env->erff)>::install(env->erff);
+    env->erfl=EnvThunk<208,decltype(env->erfl)>::install(env->erfl);
+    env->erfc=EnvThunk<209,decltype(env->erfc)>::install(env->erfc);
+    env->erfcf=EnvThunk<210,decltype(env->erfcf)>::install(env->erfcf);
+    env->erfcl=EnvThunk<211,decltype(env->erfcl)>::install(env->erfcl);
+    env->tgamma=EnvThunk<212,decltype(env->tgamma)>::install(env->tgamma);
+    env->tgammaf=EnvThunk<213,decltype(env->tgammaf)>::install(env->tgammaf);
+    env->tgammal=EnvThunk<214,decltype(env->tgammal)>::install(env->tgammal);
+    env->lgamma=EnvThunk<215,decltype(env->lgamma)>::install(env->lgamma);
+    env->lgammaf=EnvThunk<216,decltype(env->lgammaf)>::install(env->lgammaf);
+    env->lgammal=EnvThunk<217,decltype(env->lgammal)>::install(env->lgammal);
+    env->ceil=EnvThunk<218,decltype(env->ceil)>::install(env->ceil);
+    env->ceilf=EnvThunk<219,decltype(env->ceilf)>::install(env->ceilf);
+    env->ceill=EnvThunk<220,decltype(env->ceill)>::install(env->ceill);
+    env->floor=EnvThunk<221,decltype(env->floor)>::install(env->floor);
+    env->floorf=EnvThunk<222,decltype(env->floorf)>::install(env->floorf);
+    env->floorl=EnvThunk<223,decltype(env->floorl)>::install(env->floorl);
+    env->trunc=EnvThunk<224,decltype(env->trunc)>::install(env->trunc);
+    env->truncf=EnvThunk<225,decltype(env->truncf)>::install(env->truncf);
+    env->truncl=EnvThunk<226,decltype(env->truncl)>::install(env->truncl);
+    env->round=EnvThunk<227,decltype(env->round)>::install(env->round);
+    env->roundf=EnvThunk<228,decltype(env->roundf)>::install(env->roundf);
+    env->roundl=EnvThunk<229,decltype(env->roundl)>::install(env->roundl);
+    env->lround=EnvThunk<230,decltype(env->lround)>::install(env->lround);
+    env->lroundf=EnvThunk<231,decltype(env->lroundf)>::install(env->lroundf);
+    env->lroundl=EnvThunk<232,decltype(env->lroundl)>::install(env->lroundl);
+    env->llround=EnvThunk<233,decltype(env->llround)>::install(env->llround);
+    env->llroundf=EnvThunk<234,decltype(env->llroundf)>::install(env->llroundf);
+    env->llroundl=EnvThunk<235,decltype(env->llroundl)>::install(env->llroundl);
+    env->nearbyint=EnvThunk<236,decltype(env->nearbyint)>::install(env->nearbyint);
+    env->nearbyintf=EnvThunk<237,decltype(env->nearbyintf)>::install(env->nearbyintf);
+    env->nearbyintl=EnvThunk<238,decltype(env->nearbyintl)>::install(env->nearbyintl);
+    env->rint=EnvThunk<239,decltype(env->rint)>::install(env->rint);
+    env->rintf=EnvThunk<240,decltype(env->rintf)>::install(env->rintf);
+    env->rintl=EnvThunk<241,decltype(env->rintl)>::install(env->rintl);
+    env->lrint=EnvThunk<242,decltype(env->lrint)>::install(env->lrint);
+    env->lrintf=EnvThunk<243,decltype(env->lrintf)>::install(env->lrintf);
+    env->lrintl=EnvThunk<244,decltype(env->lrintl)>::install(env->lrintl);
+    env->llrint=EnvThunk<245,decltype(env->llrint)>::install(env->llrint);
+    env->llrintf=EnvThunk<246,decltype(env->llrintf)>::install(env->llrintf);
+    env->llrintl=EnvThunk<247,decltype(env->llrintl)>::install(env->llrintl);
+    env->frexp=EnvThunk<248,decltype(env->frexp)>::install(env->frexp);
+    env->frexpf=EnvThunk<249,decltype(env->frexpf)>::install(env->frexpf);
+    env->frexpl=EnvThunk<250,decltype(env->frexpl)>::install(env->frexpl);
+    env->ldexp=EnvThunk<251,decltype(env->ldexp)>::install(env->ldexp);
+    env->ldexpf=EnvThunk<252,decltype(env->ldexpf)>::install(env->ldexpf);
+    env->ldexpl=EnvThunk<253,decltype(env->ldexpl)>::install(env->ldexpl);
+    env->modf=EnvThunk<254,decltype(env->modf)>::install(env->modf);
+    env->modff=EnvThunk<255,decltype(env->modff)>::install(env->modff);
+    env->modfl=EnvThunk<256,decltype(env->modfl)>::install(env->modfl);
+    env->scalbn=EnvThunk<257,decltype(env->scalbn)>::install(env->scalbn);
+    env->scalbnf=EnvThunk<258,decltype(env->scalbnf)>::install(env->scalbnf);
+    env->scalbnl=EnvThunk<259,decltype(env->scalbnl)>::install(env->scalbnl);
+    env->scalbln=EnvThunk<260,decltype(env->scalbln)>::install(env->scalbln);
+    env->scalblnf=EnvThunk<261,decltype(env->scalblnf)>::install(env->scalblnf);
+    env->scalblnl=EnvThunk<262,decltype(env->scalblnl)>::install(env->scalblnl);
+    env->ilogb=EnvThunk<263,decltype(env->ilogb)>::install(env->ilogb);
+    env->ilogbf=EnvThunk<264,decltype(env->ilogbf)>::install(env->ilogbf);
+    env->ilogbl=EnvThunk<265,decltype(env->ilogbl)>::install(env->ilogbl);
+    env->logb=EnvThunk<266,decltype(env->logb)>::install(env->logb);
+    env->logbf=EnvThunk<267,decltype(env->logbf)>::install(env->logbf);
+    env->logbl=EnvThunk<268,decltype(env->logbl)>::install(env->logbl);
+    env->nextafter=EnvThunk<269,decltype(env->nextafter)>::install(env->nextafter);
+    env->nextafterf=EnvThunk<270,decltype(env->nextafterf)>::install(env->nextafterf);
+    env->nextafterl=EnvThunk<271,decltype(env->nextafterl)>::install(env->nextafterl);
+    env->nexttoward=EnvThunk<272,decltype(env->nexttoward)>::install(env->nexttoward);
+    env->nexttowardf=EnvThunk<273,decltype(env->nexttowardf)>::install(env->nexttowardf);
+    env->nexttowardl=EnvThunk<274,decltype(env->nexttowardl)>::install(env->nexttowardl);
+    env->copysign=EnvThunk<275,decltype(env->copysign)>::install(env->copysign);
+    env->copysignf=EnvThunk<276,decltype(env->copysignf)>::install(env->copysignf);
+    env->copysignl=EnvThunk<277,decltype(env->copysignl)>::install(env->copysignl);
+    env->strdup=EnvThunk<278,decltype(env->strdup)>::install(env->strdup);
+    env->strchr=EnvThunk<279,decltype(env->strchr)>::install(env->strchr);
+    env->strrchr=EnvThunk<280,decltype(env->strrchr)>::install(env->strrchr);
+    env->strpbrk=EnvThunk<281,decltype(env->strpbrk)>::install(env->strpbrk);
+    env->strstr=EnvThunk<282,decltype(env->strstr)>::install(env->strstr);
+    env->memchr=EnvThunk<283,decltype(env->memchr)>::install(env->memchr);
+    env->memccpy=EnvThunk<284,decltype(env->memccpy)>::install(env->memccpy);
+    env->access=EnvThunk<285,decltype(env->access)>::install(env->access);
+    env->chdir=EnvThunk<286,decltype(env->chdir)>::install(env->chdir);
+    env->getcwd=EnvThunk<287,decltype(env->getcwd)>::install(env->getcwd);
+    env->mkdir=EnvThunk<288,decltype(env->mkdir)>::install(env->mkdir);
+    env->rmdir=EnvThunk<289,decltype(env->rmdir)>::install(env->rmdir);
+    env->rename=EnvThunk<290,decltype(env->rename)>::install(env->rename);
+    env->unlink=EnvThunk<291,decltype(env->unlink)>::install(env->unlink);
+    env->close=EnvThunk<292,decltype(env->close)>::install(env->close);
+    env->dup=EnvThunk<293,decltype(env->dup)>::install(env->dup);
+    env->dup2=EnvThunk<294,decltype(env->dup2)>::install(env->dup2);
+    env->read=EnvThunk<295,decltype(env->read)>::install(env->read);
+    env->write=EnvThunk<296,decltype(env->write)>::install(env->write);
+    env->execve=EnvThunk<297,decltype(env->execve)>::install(env->execve);
+    env->getpid=EnvThunk<298,decltype(env->getpid)>::install(env->getpid);
+    env->sleep=EnvThunk<299,decltype(env->sleep)>::install(env->sleep);
+    env->usleep=EnvThunk<300,decltype(env->usleep)>::install(env->usleep);
+    env->getenv=EnvThunk<301,decltype(env->getenv)>::install(env->getenv);
+    env->isatty=EnvThunk<302,decltype(env->isatty)>::install(env->isatty);
+    env->getopt=EnvThunk<303,decltype(env->getopt)>::install(env->getopt);
+    env->ftruncate=EnvThunk<304,decltype(env->ftruncate)>::install(env->ftruncate);
+    env->lseek=EnvThunk<305,decltype(env->lseek)>::install(env->lseek);
+    env->importModule=EnvThunk<306,decltype(env->importModule)>::install(env->importModule);
+    env->getFuncById=EnvThunk<307,decltype(env->getFuncById)>::install(env->getFuncById);
+    env->getModuleHandle=EnvThunk<308,decltype(env->getModuleHandle)>::install(env->getModuleHandle);
+    env->reloadModule=EnvThunk<309,decltype(env->reloadModule)>::install(env->reloadModule);
+    env->quiescentState=EnvThunk<310,decltype(env->quiescentState)>::install(env->quiescentState);
+    env->registerThread=EnvThunk<311,decltype(env->registerThread)>::install(env->registerThread);
+    env->unregisterThread=EnvThunk<312,decltype(env->unregisterThread)>::install(env->unregisterThread);
+    env->guardedCall=EnvThunk<313,decltype(env->guardedCall)>::install(env->guardedCall);
+    env->spawn=EnvThunk<314,decltype(env->spawn)>::install(env->spawn);
+    env->join=EnvThunk<315,decltype(env->join)>::install(env->join);
+    env->parallelFor=EnvThunk<316,decltype(env->parallelFor)>::install(env->parallelFor);
+    env->ioSubmit=EnvThunk<317,decltype(env->ioSubmit)>::install(env->ioSubmit);
+    env->ioWait=EnvThunk<318,decltype(env->ioWait)>::install(env->ioWait);
+    env->fileno=EnvThunk<319,decltype(env->fileno)>::install(env->fileno);
+    env->getStats=EnvThunk<320,decltype(env->getStats)>::install(env->getStats);
+    env->arenaCreate=EnvThunk<321,decltype(env->arenaCreate)>::install(env->arenaCreate);
+    env->arenaAlloc=EnvThunk<322,decltype(env->arenaAlloc)>::install(env->arenaAlloc);
+    env->arenaReset=EnvThunk<323,decltype(env->arenaReset)>::install(env->arenaReset);
+    env->arenaDestroy=EnvThunk<324,decltype(env->arenaDestroy)>::install(env->arenaDestroy);
+    env->getModuleMemory=EnvThunk<325,decltype(env->getModuleMemory)>::install(env->getModuleMemory);
+    env->memmem=EnvThunk<326,decltype(env->memmem)>::install(env->memmem);
+}
+#pragma GCC diagnostic pop
@@ -0,0 +1,105 @@
+// 启动和导入各阶段的计时与计数，用于--stats选项和env->getStats
+#pragma once
+#include "constants.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+class StatsCollector {
+public:
+    static const char *phaseName(int phase) {
+        static const char *const NAMES[STAT_PHASE_COUNT]={
+            "runtime_init","import","resolve_path","file_open","exec_alloc",
+            "file_copy","file_map","link","load_library","get_symbol"};
+        return (phase>=0 && phase<STAT_PHASE_COUNT)?NAMES[phase]:"unknown";
+    }
+    static unsigned long long now() {
+        return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 可在多个线程中同时调用，如并行预加载依赖时
+    void record(int phase,unsigned long long elapsed_ns) {
+        Phase &entry=phases[phase];
+        entry.count.fetch_add(1,std::memory_order_relaxed);
+        entry.total_ns.fetch_add(elapsed_ns,std::memory_order_relaxed);
+        unsigned long long max=entry.max_ns.load(std::memory_order_relaxed);
+        while(elapsed_ns>max &&
+              !entry.max_ns.compare_exchange_weak(max,elapsed_ns,std::memory_order_relaxed));
+    }
+    void addModule(size_t bytes) {
+        modules_loaded.fetch_add(1,std::memory_order_relaxed);
+        bytes_mapped.fetch_add(bytes,std::memory_order_relaxed);
+    }
+    void addLibrary() {libraries_loaded.fetch_add(1,std::memory_order_relaxed);}
+
+    // 复制到out中，size为调用者的sizeof(RuntimeStats)，返回复制的字节数
+    size_t snapshot(RuntimeStats *out,size_t size) const {
+        RuntimeStats stats;
+        for(int i=0;i<STAT_PHASE_COUNT;i++){
+            stats.phases[i].count=phases[i].count.load(std::memory_order_relaxed);
+            stats.phases[i].total_ns=phases[i].total_ns.load(std::memory_order_relaxed);
+            stats.phases[i].max_ns=phases[i].max_ns.load(std::memory_order_relaxed);
+        }
+        stats.modules_loaded=modules_loaded.load(std::memory_order_relaxed);
+        stats.bytes_mapped=bytes_mapped.load(std::memory_order_relaxed);
+        stats.libraries_loaded=libraries_loaded.load(std::memory_order_relaxed);
+        if(out==nullptr) return 0;
+        if(size>sizeof(stats)) size=sizeof(stats);
+        memcpy(out,&stats,size);
+        return size;
+    }
+    void printText(FILE *out) const {
+        RuntimeStats stats;snapshot(&stats,sizeof(stats));
+        fprintf(out,"Runtime stats:\n");
+        fprintf(out,"%-14s %8s %12s %12s %12s\n","phase","count","total_us","avg_us","max_us");
+        for(int i=0;i<STAT_PHASE_COUNT;i++){
+            const PhaseStats &phase=stats.phases[i];
+            fprintf(out,"%-14s %8llu %12.1f %12.1f %12.1f\n",phaseName(i),phase.count,
+                    phase.total_ns/1e3,phase.count?phase.total_ns/1e3/phase.count:0.0,
+                    phase.max_ns/1e3);
+        }
+        fprintf(out,"Modules loaded: %llu (%llu bytes mapped)\n",
+                stats.modules_loaded,stats.bytes_mapped);
+        fprintf(out,"Libraries loaded: %llu\n",stats.libraries_loaded);
+    }
+    void printJson(FILE *out) const {
+        RuntimeStats stats;snapshot(&stats,sizeof(stats));
+        fprintf(out,"{\"phases\":{");
+        for(int i=0;i<STAT_PHASE_COUNT;i++){
+            const PhaseStats &phase=stats.phases[i];
+            fprintf(out,"%s\"%s\":{\"count\":%llu,\"total_ns\":%llu,\"max_ns\":%llu}",
+                    i?",":"",phaseName(i),phase.count,phase.total_ns,phase.max_ns);
+        }
+        fprintf(out,"},\"modules_loaded\":%llu,\"bytes_mapped\":%llu,\"libraries_loaded\":%llu}\n",
+                stats.modules_loaded,stats.bytes_mapped,stats.libraries_loaded);
+    }
+private:
+    struct Phase{
+        std::atomic<unsigned long long> count{0},total_ns{0},max_ns{0};
+    };
+    Phase phases[STAT_PHASE_COUNT];
+    std::atomic<unsigned long long> modules_loaded{0},bytes_mapped{0},libraries_loaded{0};
+};
+
+// 在作用域结束或调用stop时记录经过的时间
+class StatTimer {
+public:
+    StatTimer(StatsCollector &stats,int phase)
+        :stats(stats),phase(phase),start(StatsCollector::now()) {}
+    StatTimer(const StatTimer &)=delete;
+    StatTimer &operator=(const StatTimer &)=delete;
+    ~StatTimer() {stop();}
+    void stop() {
+        if(stopped) return;
+        stopped=true;
+        stats.record(phase,StatsCollector::now()-start);
+    }
+private:
+    StatsCollector &stats;
+    int phase;
+    unsigned long long start;
+    bool stopped=false;
+};
@@ -0,0 +1,182 @@
+// 读取当前可执行文件自身的符号表，得到函数的地址和大小，用于bin_dk批量导出
+// ELF使用.symtab(没有时使用.dynsym)的st_size，PE使用COFF符号表，大小来自.pdata(仅x64)
+// 可执行文件不能用-s编译，否则符号表会被删除
+#pragma once
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <link.h>
+#include <unistd.h>
+#endif
+
+struct FuncSymbol{
+    std::string name; // 编译器生成的符号名，C++函数为修饰后的名称
+    std::string section; // 函数所在的节
+    void *address; // 运行时的地址
+    size_t size; // 为0时表示大小未知
+};
+
+namespace _symbol_table_h{
+using namespace std;
+
+inline string readWholeFile(const char *filename){
+    FILE *file=fopen(filename,"rb");
+    if(!file) throw runtime_error(string("Cannot open ")+filename+": "+strerror(errno));
+    string data;char buf[65536];size_t count;
+    while((count=fread(buf,1,sizeof(buf),file))>0) data.append(buf,count);
+    fclose(file);
+    return data;
+}
+template<typename T>
+inline const T *fileAt(const string &data,size_t offset,size_t count=1){
+    // 检查越界后返回文件中offset处的结构体
+    if(offset>data.size() || count>(data.size()-offset)/sizeof(T))
+        throw runtime_error("Corrupted executable file");
+    return (const T *)(data.data()+offset);
+}
+
+#ifndef _WIN32
+inline int findMainBase(struct dl_phdr_info *info,size_t,void *data){
+    *(size_t *)data=info->dlpi_addr; // 第一个对象为主程序
+    return 1;
+}
+inline vector<FuncSymbol> readFunctionSymbols(const char *filename=nullptr){
+    if(filename==nullptr) filename="/proc/self/exe";
+    string data=readWholeFile(filename);
+    const ElfW(Ehdr) *ehdr=fileAt<ElfW(Ehdr)>(data,0);
+    if(memcmp(ehdr->e_ident,ELFMAG,SELFMAG)!=0 || ehdr->e_ident[EI_CLASS]!=
+       (sizeof(void *)==8?ELFCLASS64:ELFCLASS32))
+        throw runtime_error("Unsupported executable format");
+    const ElfW(Shdr) *sections=fileAt<ElfW(Shdr)>(data,ehdr->e_shoff,ehdr->e_shnum);
+    const char *section_names=nullptr;
+    if(ehdr->e_shstrndx<ehdr->e_shnum){
+        const ElfW(Shdr) &shstr=sections[ehdr->e_shstrndx];
+        section_names=fileAt<char>(data,shstr.sh_offset,shstr.sh_size);
+    }
+    // 优先使用完整的.symtab，被strip时退回只含导出符号的.dynsym
+    const ElfW(Shdr) *symtab=nullptr;
+    for(int i=0;i<ehdr->e_shnum;i++){
+        if(sections[i].sh_type==SHT_SYMTAB) symtab=&sections[i];
+        else if(sections[i].sh_type==SHT_DYNSYM && symtab==nullptr) symtab=&sections[i];
+    }
+    if(symtab==nullptr || symtab->sh_link>=ehdr->e_shnum)
+        throw runtime_error("No symbol table found (compiled with -s?)");
+    size_t sym_count=symtab->sh_size/sizeof(ElfW(Sym));
+    const ElfW(Sym) *syms=fileAt<ElfW(Sym)>(data,symtab->sh_offset,sym_count);
+    const ElfW(Shdr) &strtab=sections[symtab->sh_link];
+    const char *names=fileAt<char>(data,strtab.sh_offset,strtab.sh_size);
+
+    size_t base=0;
+    dl_iterate_phdr(findMainBase,&base); // 位置无关的可执行文件需要加上加载地址
+    vector<FuncSymbol> result;
+    for(size_t i=0;i<sym_count;i++){
+        const ElfW(Sym) &sym=syms[i];
+        if(ELF64_ST_TYPE(sym.st_info)!=STT_FUNC || sym.st_shndx==SHN_UNDEF ||
+           sym.st_shndx>=ehdr->e_shnum || sym.st_name>=strtab.sh_size) continue;
+        const char *section="";
+        if(section_names!=nullptr && sections[sym.st_shndx].sh_name<
+           sections[ehdr->e_shstrndx].sh_size)
+            section=section_names+sections[sym.st_shndx].sh_name;
+        result.push_back(FuncSymbol{names+sym.st_name,section,
+                                    (void *)(base+sym.st_value),(size_t)sym.st_size});
+    }
+    return result;
+}
+#else
+struct PdataEntry{ // 与x64的RUNTIME_FUNCTION相同
+    uint32_t begin;
+    uint32_t end;
+    uint32_t unwind_info;
+};
+inline size_t findPdataSize(const char *image,const IMAGE_NT_HEADERS *nt,uint32_t rva){
+    // 在.pdata中二分查找起始地址为rva的函数，返回函数大小，没有时返回0
+#ifdef _WIN64
+    const IMAGE_DATA_DIRECTORY &dir=
+        nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXCEPTION];
+    const PdataEntry *entries=(const PdataEntry *)(image+dir.VirtualAddress);
+    size_t low=0,high=dir.Size/sizeof(PdataEntry);
+    while(low<high){
+        size_t mid=low+(high-low)/2;
+        if(entries[mid].begin<rva) low=mid+1;
+        else high=mid;
+    }
+    if(low<dir.Size/sizeof(PdataEntry) && entries[low].begin==rva)
+        return entries[low].end-entries[low].begin;
+#endif
+    return 0;
+}
+inline vector<FuncSymbol> readFunctionSymbols(const char *filename=nullptr){
+    char path[MAX_PATH];
+    if(filename==nullptr){
+        GetModuleFileNameA(NULL,path,MAX_PATH);
+        filename=path;
+    }
+    string data=readWholeFile(filename);
+    const IMAGE_DOS_HEADER *dos=fileAt<IMAGE_DOS_HEADER>(data,0);
+    if(dos->e_magic!=IMAGE_DOS_SIGNATURE)
+        throw runtime_error("Unsupported executable format");
+    const IMAGE_NT_HEADERS *file_nt=fileAt<IMAGE_NT_HEADERS>(data,dos->e_lfanew);
+    const IMAGE_FILE_HEADER &header=file_nt->FileHeader;
+    if(file_nt->Signature!=IMAGE_NT_SIGNATURE)
+        throw runtime_error("Unsupported executable format");
+    if(header.PointerToSymbolTable==0 || header.NumberOfSymbols==0)
+        throw runtime_error("No symbol table found (compiled with -s?)");
+    const IMAGE_SECTION_HEADER *sections=fileAt<IMAGE_SECTION_HEADER>(data,
+        dos->e_lfanew+offsetof(IMAGE_NT_HEADERS,OptionalHeader)+header.SizeOfOptionalHeader,
+        header.NumberOfSections);
+    // COFF符号表的每项为18字节，紧跟其后的是字符串表
+    const char *syms=fileAt<char>(data,header.PointerToSymbolTable,
+                                  (size_t)header.NumberOfSymbols*IMAGE_SIZEOF_SYMBOL);
+    size_t strtab_offset=header.PointerToSymbolTable+
+                         (size_t)header.NumberOfSymbols*IMAGE_SIZEOF_SYMBOL;
+    const char *image=(const char *)GetModuleHandleA(NULL);
+    const IMAGE_NT_HEADERS *nt=(const IMAGE_NT_HEADERS *)
+                               (image+((const IMAGE_DOS_HEADER *)image)->e_lfanew);
+
+    vector<FuncSymbol> result;
+    for(DWORD i=0;i<header.NumberOfSymbols;i++){
+        IMAGE_SYMBOL sym;
+        memcpy(&sym,syms+(size_t)i*IMAGE_SIZEOF_SYMBOL,IMAGE_SIZEOF_SYMBOL);
+        i+=sym.NumberOfAuxSymbols;
+        if(!ISFCN(sym.Type) || sym.SectionNumber<=0 || sym.SectionNumber>header.NumberOfSections ||
+           (sym.StorageClass!=IMAGE_SYM_CLASS_EXTERNAL && sym.StorageClass!=IMAGE_SYM_CLASS_STATIC))
+            continue;
+        string name;
+        if(sym.N.Name.Short==0) // 长名称存放在字符串表中
+            name=fileAt<char>(data,strtab_offset+sym.N.Name.Long);
+        else
+            name=string((const char *)sym.N.ShortName,strnlen((const char *)sym.N.ShortName,8));
+        const IMAGE_SECTION_HEADER &section=sections[sym.SectionNumber-1];
+        uint32_t rva=section.VirtualAddress+sym.Value;
+        result.push_back(FuncSymbol{name,
+            string((const char *)section.Name,strnlen((const char *)section.Name,8)),
+            (void *)(image+rva),findPdataSize(image,nt,rva)});
+    }
+    return result;
+}
+#endif
+
+// 简单的通配符匹配，支持*和?
+inline bool matchPattern(const char *pattern,const char *str){
+    const char *star=nullptr,*retry=nullptr;
+    while(*str){
+        if(*pattern=='?' || *pattern==*str){pattern++;str++;}
+        else if(*pattern=='*'){star=pattern++;retry=str;}
+        else if(star!=nullptr){pattern=star+1;str=++retry;}
+        else return false;
+    }
+    while(*pattern=='*') pattern++;
+    return *pattern=='\0';
+}
+}
+
+using _symbol_table_h::readFunctionSymbols;
+using _symbol_table_h::matchPattern;
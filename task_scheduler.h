@@ -0,0 +1,209 @@
+// 工作窃取的任务调度器，供bin文件通过env->spawn、join和parallelFor使用多个CPU核心
+// 每个工作线程有自己的双端队列，从队尾取出自己的任务，空闲时从其他线程的队首窃取
+#pragma once
+#include "epoch_reclaimer.h"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskScheduler {
+public:
+    using TaskFunc=int (*)(void *);
+    using RangeFunc=void (*)(long long,long long,void *);
+    using CallFunc=int (*)(TaskFunc,void *); // 执行任务的方式，如guardedCall
+
+    // threads为0时使用CPU核心数，工作线程在第一次提交任务时才创建
+    TaskScheduler(unsigned int threads,EpochReclaimer *reclaimer=nullptr,CallFunc call=nullptr)
+        :thread_count(threads?threads:std::max(1u,std::thread::hardware_concurrency())),
+         reclaimer(reclaimer),call(call) {}
+    ~TaskScheduler() {stop();}
+    TaskScheduler(const TaskScheduler &)=delete;
+    TaskScheduler &operator=(const TaskScheduler &)=delete;
+
+    // 提交任务，返回的句柄须传给join一次，join之后失效
+    void *spawn(TaskFunc func,void *arg) {
+        Task *task=new Task{func,arg};
+        push(task);
+        return task;
+    }
+    // 等待任务完成并返回func的返回值，等待期间当前线程会执行其他任务，因此可以在任务中调用
+    int join(void *handle) {
+        Task *task=(Task *)handle;
+        waitFor([task]{return task->done.load(std::memory_order_acquire);});
+        int result=task->result;
+        delete task;
+        return result;
+    }
+    // 将[begin,end)分成长度为grain的块并行调用func(块的起点,块的终点,ctx)，grain<=0时自动选择
+    // 全部完成后返回，有块出错(返回INT_MAX)时返回INT_MAX，否则返回0
+    int parallelFor(long long begin,long long end,long long grain,RangeFunc func,void *ctx) {
+        if(begin>=end) return 0;
+        long long total=end-begin;
+        if(grain<=0) grain=std::max(1LL,total/(long long)(thread_count*8)); // 每个线程约8块，平衡负载
+        Range range{begin,end,grain,func,ctx};
+        range.next.store(begin,std::memory_order_relaxed);
+        long long chunks=(total+grain-1)/grain;
+        // 分块由参与的线程动态领取，只需为其他线程提交min(块数,线程数)-1个任务
+        size_t helpers=(size_t)std::min<long long>(chunks,thread_count)-1;
+        std::vector<Task *> tasks;
+        for(size_t i=0;i<helpers;i++){
+            tasks.push_back(new Task{runRange,&range});
+            push(tasks.back());
+        }
+        int result=execute(runRange,&range);
+        for(Task *task:tasks){
+            // 未被其他线程领取的任务由当前线程执行，此时分块通常已经领完
+            if(join(task)==INT_MAX) result=INT_MAX;
+        }
+        return result;
+    }
+    // 结束所有工作线程，之前提交的任务会先执行完
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(!started) return;
+            stopping=true;
+        }
+        wake.notify_all();
+        for(std::thread &worker:workers) worker.join();
+        workers.clear();
+        started=false;stopping=false;
+    }
+    unsigned int size() const {return thread_count;}
+private:
+    struct Task{
+        TaskFunc func;
+        void *arg;
+        int result=0;
+        std::atomic<bool> done{false};
+    };
+    struct Range{
+        long long begin,end,grain;
+        RangeFunc func;
+        void *ctx;
+        std::atomic<long long> next;
+    };
+    struct alignas(64) Queue{ // 独占缓存行，避免线程之间的伪共享
+        std::mutex mtx;
+        std::deque<Task *> tasks;
+    };
+
+    static int runRange(void *arg) {
+        Range &range=*(Range *)arg;
+        long long lo;
+        while((lo=range.next.fetch_add(range.grain,std::memory_order_relaxed))<range.end)
+            range.func(lo,std::min(lo+range.grain,range.end),range.ctx);
+        return 0;
+    }
+    int execute(TaskFunc func,void *arg) {
+        return call?call(func,arg):func(arg);
+    }
+    void run(Task *task) {
+        task->result=execute(task->func,task->arg);
+        task->done.store(true,std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mtx); // 避免与等待者检查条件之间的竞争
+        }
+        finished.notify_all();
+    }
+    void push(Task *task) {
+        start();
+        // 工作线程放入自己的队列，其他线程(如主线程)放入共享队列
+        Queue &queue=(worker_index>=0 && owner==this)?*queues[worker_index]:injected;
+        queued.fetch_add(1,std::memory_order_release); // 先增加计数，queued不会小于队列中的任务数
+        {
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            queue.tasks.push_back(task);
+        }
+        if(sleeping.load(std::memory_order_acquire)>0){
+            std::lock_guard<std::mutex> lock(mtx);
+            wake.notify_one();
+        }
+    }
+    Task *take() {
+        if(queued.load(std::memory_order_acquire)==0) return nullptr;
+        int self=(owner==this)?worker_index:-1;
+        Task *task=nullptr;
+        if(self>=0) task=popBack(*queues[self]); // 自己最近提交的任务，缓存中的数据较新
+        if(task==nullptr) task=popFront(injected);
+        for(size_t i=1;task==nullptr && i<=queues.size();i++){
+            size_t victim=(size_t)(self+i+steal_seed++)%queues.size();
+            if((int)victim!=self) task=popFront(*queues[victim]); // 窃取最早提交的任务，通常是较大的任务
+        }
+        if(task!=nullptr) queued.fetch_sub(1,std::memory_order_relaxed);
+        return task;
+    }
+    static Task *popBack(Queue &queue) {
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if(queue.tasks.empty()) return nullptr;
+        Task *task=queue.tasks.back();queue.tasks.pop_back();
+        return task;
+    }
+    static Task *popFront(Queue &queue) {
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if(queue.tasks.empty()) return nullptr;
+        Task *task=queue.tasks.front();queue.tasks.pop_front();
+        return task;
+    }
+    template<typename Pred>
+    void waitFor(Pred done) {
+        while(!done()){
+            if(Task *task=take()){
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mtx);
+            finished.wait_for(lock,std::chrono::milliseconds(1),done); // 任务可能在其他线程中执行
+        }
+    }
+    void start() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(started) return;
+        started=true;
+        queues.clear();
+        for(unsigned int i=0;i<thread_count;i++) queues.emplace_back(new Queue);
+        for(unsigned int i=0;i<thread_count;i++) workers.emplace_back([this,i]{workerLoop(i);});
+    }
+    void workerLoop(int index) {
+        worker_index=index;owner=this;
+        if(reclaimer) reclaimer->registerThread(); // 工作线程会运行模块代码
+        while(true){
+            if(Task *task=take()){
+                run(task);
+                if(reclaimer) reclaimer->quiescent(); // 任务之间不持有任何函数指针
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mtx);
+            if(stopping && queued.load(std::memory_order_acquire)==0) break;
+            if(reclaimer) reclaimer->offline(); // 空闲的线程不阻止释放旧模块
+            sleeping.fetch_add(1,std::memory_order_acq_rel);
+            wake.wait_for(lock,std::chrono::milliseconds(100),[this]{
+                return stopping || queued.load(std::memory_order_acquire)>0;});
+            sleeping.fetch_sub(1,std::memory_order_acq_rel);
+            if(reclaimer) reclaimer->online();
+        }
+        if(reclaimer) reclaimer->unregisterThread();
+        worker_index=-1;owner=nullptr;
+    }
+
+    unsigned int thread_count;
+    EpochReclaimer *reclaimer;
+    CallFunc call;
+    std::vector<std::unique_ptr<Queue>> queues;
+    Queue injected; // 非工作线程提交的任务
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0}; // 所有队列中的任务数
+    std::atomic<int> sleeping{0};
+    std::mutex mtx;
+    std::condition_variable wake,finished;
+    bool started=false,stopping=false;
+    static inline thread_local int worker_index=-1;
+    static inline thread_local TaskScheduler *owner=nullptr;
+    static inline thread_local unsigned int steal_seed=0;
+};
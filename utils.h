@@ -1,5 +1,6 @@
 // 存储bin_dk和bin_runtime共用的函数、类等
 #include "constants.h"
+#include "byte_scanner.h"
 #include <cstdio>
 #include <cstring>
 #include <climits>
@@ -7,10 +8,13 @@
 #include <stdexcept>
 #include <csignal>
 #include <csetjmp>
+#include <string>
 #ifdef _WIN32
 #include <windows.h>
 #else  
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 
@@ -53,14 +57,8 @@ char *convert_size(size_t size){
 
 // -- 辅助操作内存函数 --
 void* find_submem(const void* mem, size_t memsize, const void *submem,size_t submem_size) {
-    // 在内存块中查找子内存，类似memmem函数
-    for (size_t i = 0; i < memsize - submem_size; i++) {
-        const uchar *cur=(uchar *)mem + i;
-        if (memcmp(cur, submem, submem_size) == 0) {
-            return const_cast<void*>((const void *)cur);
-        }
-    }
-    return nullptr; // 未找到
+    // 在内存块中查找子内存，类似memmem函数，未找到时返回nullptr
+    return findBytes(mem,memsize,submem,submem_size);
 }
 void dumpMemory(void* start, const char *filename, size_t size) {
     FILE* dump_file = fopen(filename, "wb");
@@ -79,7 +77,7 @@ void showMemory(void *ptr,size_t size){
 }
 
 // -- 依赖于段错误的内存检测函数 --
-static jmp_buf jmp_env;
+static thread_local jmp_buf jmp_env; // 每个线程有各自的恢复点
 void signal_handler(int signum) {
     signal(signum, signal_handler); // 重新设置信号处理器，避免丢失
     longjmp(jmp_env, signum); // 跳转到jmp_env保存的环境
@@ -170,6 +168,11 @@ void freeExecMemory(void *pMemory, size_t size=0) {
     if (!VirtualFree(pMemory, 0, MEM_RELEASE))
         throw runtime_error("Cannot free virtual memory");
 }
+void *tryAllocExecMemoryAt(void *hint,size_t size){
+    // 在hint处申请，已被占用时返回nullptr
+    hint=(void *)((size_t)hint&~(size_t)0xffff); // 按分配粒度(64KB)对齐
+    return VirtualAlloc(hint,size,MEM_COMMIT|MEM_RESERVE,PAGE_EXECUTE_READWRITE);
+}
 #else
 void *allocExecMemory(size_t size){
     void *pMemory = mmap(nullptr, size,
@@ -182,6 +185,111 @@ void freeExecMemory(void *pMemory, size_t size) {
     if (munmap(pMemory, size) != 0)
         throw runtime_error("Cannot free virtual memory");
 }
+void *tryAllocExecMemoryAt(void *hint,size_t size){
+    // 在hint附近申请，内核未采用hint时返回nullptr
+    void *pMemory=mmap(hint,size,PROT_READ|PROT_WRITE|PROT_EXEC,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if(pMemory==MAP_FAILED) return nullptr;
+    if(pMemory!=hint){munmap(pMemory,size);return nullptr;}
+    return pMemory;
+}
+#endif
+void *allocExecMemoryNear(const void *addr,size_t size,size_t range=(size_t)1<<31){
+    // 申请与addr的距离小于range的可执行内存，用于rel32跳转，失败时返回nullptr
+    const size_t step=(size_t)1<<24; // 每次尝试间隔16MB
+    size_t base=(size_t)addr&~(step-1);
+    for(size_t distance=step;distance+size<range;distance+=step){
+        if(base>distance){
+            void *ptr=tryAllocExecMemoryAt((void *)(base-distance),size);
+            if(ptr!=nullptr) return ptr;
+        }
+        void *ptr=tryAllocExecMemoryAt((void *)(base+distance),size);
+        if(ptr!=nullptr) return ptr;
+    }
+    return nullptr;
+}
+
+inline void prefaultMemory(const void *ptr,size_t size){
+    // 逐页读取，预先触发缺页
+#ifdef _WIN32
+    SYSTEM_INFO info;GetSystemInfo(&info);
+    size_t pagesize=info.dwPageSize;
+#else
+    size_t pagesize=sysconf(_SC_PAGESIZE);
+#endif
+    for(size_t i=0;i<size;i+=pagesize)
+        (void)*(volatile const uchar *)((const uchar *)ptr+i);
+}
+
+// -- 将文件直接映射为可执行内存，避免复制 (依赖特定平台) --
+#ifdef _WIN32
+void *mapExecFile(const char *filename,size_t *size,bool prefault=false){
+    HANDLE file=CreateFileA(filename,GENERIC_READ|GENERIC_EXECUTE,FILE_SHARE_READ,
+                            NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(file==INVALID_HANDLE_VALUE)
+        throw filenotfound(("Cannot open file: "+to_string(GetLastError())).c_str());
+    LARGE_INTEGER filesize;
+    if(!GetFileSizeEx(file,&filesize) || filesize.QuadPart==0){
+        CloseHandle(file);
+        throw runtime_error("Error reading file");
+    }
+    // PAGE_EXECUTE_WRITECOPY使映射之后可以通过makeExecWritable改为写时复制
+    HANDLE mapping=CreateFileMappingA(file,NULL,PAGE_EXECUTE_WRITECOPY,0,0,NULL);
+    CloseHandle(file);
+    if(mapping==NULL) throw runtime_error("Cannot map file for execution");
+    void *view=MapViewOfFile(mapping,FILE_MAP_READ|FILE_MAP_EXECUTE,0,0,0);
+    CloseHandle(mapping); // 视图会保持映射的引用
+    if(view==NULL) throw runtime_error("Cannot map file for execution");
+    *size=(size_t)filesize.QuadPart;
+    if(prefault){ // 逐页访问，预先触发缺页
+        SYSTEM_INFO info;GetSystemInfo(&info);
+        for(size_t i=0;i<*size;i+=info.dwPageSize)
+            volatile uchar b=((uchar *)view)[i];
+    }
+    return view;
+}
+void unmapExecFile(void *ptr,size_t size=0){
+    if(!UnmapViewOfFile(ptr))
+        throw runtime_error("Cannot unmap file");
+}
+void makeExecWritable(void *ptr,size_t size){
+    // 修改后的页面为进程私有的副本，不影响文件和其他进程
+    DWORD old_protect;
+    if(!VirtualProtect(ptr,size,PAGE_EXECUTE_WRITECOPY,&old_protect))
+        throw runtime_error("Cannot make memory writable");
+}
+#else
+void *mapExecFile(const char *filename,size_t *size,bool prefault=false){
+    int fd=open(filename,O_RDONLY);
+    if(fd<0) throw filenotfound(strerror(errno));
+    struct stat st;
+    if(fstat(fd,&st)!=0 || st.st_size==0){
+        close(fd);
+        throw runtime_error("Error reading file");
+    }
+    // 未写入的页面和页缓存共享，因此原地改写文件(包括cp -f)会改变正在运行的代码，截断文件会导致SIGBUS，
+    // 更新模块时须写入新文件再rename替换，旧的映射仍指向原来的inode
+    int flags=MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if(prefault)flags|=MAP_POPULATE;
+#endif
+    void *ptr=mmap(nullptr,st.st_size,PROT_READ|PROT_EXEC,flags,fd,0);
+    close(fd); // 映射会保持文件的引用
+    if(ptr==MAP_FAILED) throw runtime_error("Cannot map file for execution");
+    if(prefault)madvise(ptr,st.st_size,MADV_WILLNEED);
+    *size=st.st_size;
+    return ptr;
+}
+void unmapExecFile(void *ptr,size_t size){
+    if(munmap(ptr,size)!=0)
+        throw runtime_error("Cannot unmap file");
+}
+void makeExecWritable(void *ptr,size_t size){
+    // MAP_PRIVATE的映射在写入时复制，不影响文件和其他进程
+    size_t pagesize=sysconf(_SC_PAGESIZE);
+    size_t start=(size_t)ptr&~(pagesize-1);
+    if(mprotect((void *)start,(size_t)ptr+size-start,PROT_READ|PROT_WRITE|PROT_EXEC)!=0)
+        throw runtime_error("Cannot make memory writable");
+}
 #endif
 }
 
@@ -199,4 +307,9 @@ using _utils_h::getHighBoundary;
 using _utils_h::getLowBoundary;
 using _utils_h::getMemBlock;
 using _utils_h::allocExecMemory;
-using _utils_h::freeExecMemory;
\ No newline at end of file
+using _utils_h::freeExecMemory;
+using _utils_h::prefaultMemory;
+using _utils_h::allocExecMemoryNear;
+using _utils_h::mapExecFile;
+using _utils_h::unmapExecFile;
+using _utils_h::makeExecWritable;
\ No newline at end of file
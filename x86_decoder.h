@@ -0,0 +1,257 @@
+// x86/x86-64指令长度解码器，用于确定函数机器码的实际范围
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unordered_set>
+
+enum X86Flow{
+    FLOW_NONE=0, // 顺序执行下一条指令
+    FLOW_JCC, // 条件跳转，目标为target
+    FLOW_JMP, // 无条件相对跳转，目标为target
+    FLOW_CALL, // 相对调用，目标为target
+    FLOW_CALL_INDIRECT,
+    FLOW_JMP_INDIRECT,
+    FLOW_RET,
+    FLOW_STOP, // ud2、hlt、int3等不会执行到下一条的指令
+};
+struct X86Instruction{
+    size_t length;
+    int flow;
+    long long target; // 相对跳转、调用的目标偏移量，相对于指令开头
+    int opcode_map; // 0为单字节操作码，1为0F，2为0F38，3为0F3A
+    uint8_t opcode;
+    uint8_t rex; // 64位的REX前缀，不存在时为0
+    bool has_modrm;
+    uint8_t modrm;
+    bool has_sib;
+    uint8_t sib;
+    size_t modrm_offset; // ModRM字节相对于指令开头的偏移量
+    int disp_size;
+    long long disp;
+    bool opsize_prefix; // 66前缀
+};
+
+namespace _x86_decoder_h{
+// 单字节操作码是否带ModRM，按位存储
+const uint8_t ONEBYTE_MODRM[32]={
+    0x0f,0x0f,0x0f,0x0f,0x0f,0x0f,0x0f,0x0f, // 00-3F的算术指令
+    0x00,0x00,0x00,0x00,0x0c,0x0a,0x00,0x00, // 62 63 69 6B
+    0xff,0xff,0x00,0x00,0x00,0x00,0x00,0x00, // 80-8F
+    0xf3,0x00,0x0f,0xff,0x00,0x00,0xc0,0xc0, // C0 C1 C4-C7 D0-D3 D8-DF F6 F7 FE FF
+};
+// 0F开头的双字节操作码中不带ModRM的指令
+const uint8_t TWOBYTE_NO_MODRM[32]={
+    0xe0,0x4b,0x00,0x00,0x00,0x00,0xff,0x00, // 05-07 08 09 0B 0E 30-37
+    0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00, // 77
+    0xff,0xff,0x00,0x00,0x07,0x07,0x00,0x00, // 80-8F A0-A2 A8-AA
+    0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00, // C8-CF
+};
+inline bool testBit(const uint8_t *table,uint8_t index){
+    return (table[index>>3]>>(index&7))&1;
+}
+inline bool twoByteHasImm8(uint8_t op){
+    return (op>=0x70 && op<=0x73) || op==0xa4 || op==0xac || op==0xba ||
+           op==0xc2 || op==0xc4 || op==0xc5 || op==0xc6;
+}
+}
+
+// 解码code处的一条指令，maxlen为可读取的字节数，失败时返回0
+inline size_t decodeX86(const uint8_t *code,size_t maxlen,X86Instruction *ins,
+                        bool x64=(sizeof(void *)==8)){
+    using namespace _x86_decoder_h;
+    memset(ins,0,sizeof(X86Instruction));
+    size_t pos=0;
+    bool opsize=false,addrsize=false;
+    // 前缀
+    while(pos<maxlen){
+        uint8_t b=code[pos];
+        if(b==0x66) opsize=true;
+        else if(b==0x67) addrsize=true;
+        else if(b==0xf0 || b==0xf2 || b==0xf3 || b==0x26 || b==0x2e ||
+                b==0x36 || b==0x3e || b==0x64 || b==0x65) ;
+        else break;
+        if(++pos>=15) return 0;
+    }
+    if(x64 && pos<maxlen && (code[pos]&0xf0)==0x40) ins->rex=code[pos++];
+    if(pos>=maxlen) return 0;
+    bool rex_w=(ins->rex&8)!=0;
+    ins->opsize_prefix=opsize;
+
+    uint8_t op=code[pos++];
+    bool has_modrm=false;size_t imm=0;
+    int map=0;
+    if((op==0xc4 || op==0xc5) && pos<maxlen && (x64 || (code[pos]&0xc0)==0xc0)){
+        // VEX前缀
+        if(op==0xc5){
+            map=1;pos++;
+        } else {
+            if(pos+1>=maxlen) return 0;
+            map=code[pos]&0x1f;pos+=2;
+            if(map<1 || map>3) return 0;
+        }
+        if(pos>=maxlen) return 0;
+        op=code[pos++];has_modrm=true;
+        if(map==3) imm=1;
+        else if(map==1 && twoByteHasImm8(op)) imm=1;
+    } else if(op==0x62 && x64){ // EVEX前缀
+        if(pos+3>=maxlen) return 0;
+        map=code[pos]&0x07;pos+=3;
+        if(map<1 || map>3) return 0;
+        op=code[pos++];has_modrm=true;
+        if(map==3) imm=1;
+        else if(map==1 && twoByteHasImm8(op)) imm=1;
+    } else if(op==0x0f){
+        if(pos>=maxlen) return 0;
+        op=code[pos++];map=1;
+        if(op==0x38 || op==0x3a){
+            if(pos>=maxlen) return 0;
+            map=(op==0x38)?2:3;
+            op=code[pos++];has_modrm=true;
+            if(map==3) imm=1;
+        } else if(op==0x0f){ // 3DNow!
+            has_modrm=true;imm=1;
+        } else {
+            has_modrm=!testBit(TWOBYTE_NO_MODRM,op);
+            if(twoByteHasImm8(op)) imm=1;
+            if(op>=0x80 && op<=0x8f){imm=opsize?2:4;ins->flow=FLOW_JCC;}
+            else if(op==0x0b) ins->flow=FLOW_STOP; // ud2
+        }
+    } else {
+        has_modrm=testBit(ONEBYTE_MODRM,op);
+        if(!x64 && (op==0x62 || op==0xc4 || op==0xc5)) has_modrm=true; // BOUND、LES、LDS
+        size_t imm_z=opsize?2:4; // 操作数大小的立即数
+        if(op<0x40 && (op&7)==4) imm=1;
+        else if(op<0x40 && (op&7)==5) imm=imm_z;
+        else if(op==0x68 || op==0x69 || op==0x81 || op==0xa9 || op==0xc7) imm=imm_z;
+        else if(op==0x6a || op==0x6b || op==0x80 || op==0x82 || op==0x83 ||
+                op==0xa8 || op==0xc0 || op==0xc1 || op==0xc6 || op==0xcd ||
+                (op>=0xb0 && op<=0xb7) || (op>=0xe4 && op<=0xe7) ||
+                (!x64 && (op==0xd4 || op==0xd5))) imm=1;
+        else if(op>=0xb8 && op<=0xbf) imm=rex_w?8:imm_z;
+        else if(op>=0xa0 && op<=0xa3) imm=x64?(addrsize?4:8):(addrsize?2:4); // moffs
+        else if(op==0xc2 || op==0xca) imm=2;
+        else if(op==0xc8) imm=3;
+        else if(!x64 && (op==0x9a || op==0xea)) imm=opsize?4:6;
+        else if(x64 && (op==0x9a || op==0xea || (op>=0x06 && op<=0x07) || op==0x0e ||
+                        op==0x16 || op==0x17 || op==0x1e || op==0x1f || op==0x27 ||
+                        op==0x2f || op==0x37 || op==0x3f || op==0x60 || op==0x61 ||
+                        op==0xce || op==0xd4 || op==0xd5 || op==0xd6))
+            return 0; // 64位模式中无效的指令
+        // 控制流
+        if(op>=0x70 && op<=0x7f){imm=1;ins->flow=FLOW_JCC;}
+        else if(op>=0xe0 && op<=0xe3){imm=1;ins->flow=FLOW_JCC;} // loop、jcxz
+        else if(op==0xeb){imm=1;ins->flow=FLOW_JMP;}
+        else if(op==0xe9){imm=opsize&&!x64?2:4;ins->flow=FLOW_JMP;}
+        else if(op==0xe8){imm=opsize&&!x64?2:4;ins->flow=FLOW_CALL;}
+        else if(op==0xc3 || op==0xc2 || op==0xcb || op==0xca || op==0xcf) ins->flow=FLOW_RET;
+        else if(op==0xcc || op==0xf4) ins->flow=FLOW_STOP;
+    }
+    ins->opcode=op;ins->opcode_map=map;
+
+    if(has_modrm){
+        if(pos>=maxlen) return 0;
+        uint8_t modrm=code[pos];
+        ins->has_modrm=true;ins->modrm=modrm;ins->modrm_offset=pos++;
+        uint8_t mod=modrm>>6,reg=(modrm>>3)&7,rm=modrm&7;
+        if(map==0){
+            if(op==0xf6 && reg<2) imm=1; // test r/m8,imm8
+            else if(op==0xf7 && reg<2) imm=opsize?2:4;
+            else if(op==0xff){
+                if(reg==2) ins->flow=FLOW_CALL_INDIRECT;
+                else if(reg==3) ins->flow=FLOW_CALL_INDIRECT;
+                else if(reg==4 || reg==5) ins->flow=FLOW_JMP_INDIRECT;
+            }
+        }
+        if(mod!=3){
+            if(!x64 && addrsize){ // 16位寻址
+                if(mod==0 && rm==6) ins->disp_size=2;
+                else if(mod==1) ins->disp_size=1;
+                else if(mod==2) ins->disp_size=2;
+            } else {
+                if(rm==4){
+                    if(pos>=maxlen) return 0;
+                    ins->has_sib=true;ins->sib=code[pos++];
+                    if(mod==0 && (ins->sib&7)==5) ins->disp_size=4;
+                }
+                if(mod==0 && rm==5) ins->disp_size=4; // 64位模式中为RIP相对寻址
+                else if(mod==1) ins->disp_size=1;
+                else if(mod==2) ins->disp_size=4;
+            }
+        }
+        if(pos+ins->disp_size>maxlen) return 0;
+        if(ins->disp_size==1) ins->disp=(int8_t)code[pos];
+        else if(ins->disp_size==2){int16_t d;memcpy(&d,code+pos,2);ins->disp=d;}
+        else if(ins->disp_size==4){int32_t d;memcpy(&d,code+pos,4);ins->disp=d;}
+        pos+=ins->disp_size;
+    }
+    if(pos+imm>maxlen) return 0;
+    if(ins->flow==FLOW_JCC || ins->flow==FLOW_JMP || ins->flow==FLOW_CALL){
+        long long rel;
+        if(imm==1) rel=(int8_t)code[pos];
+        else if(imm==2){int16_t d;memcpy(&d,code+pos,2);rel=d;}
+        else {int32_t d;memcpy(&d,code+pos,4);rel=d;}
+        ins->target=(long long)(pos+imm)+rel;
+    }
+    pos+=imm;
+    if(pos>15) return 0;
+    ins->length=pos;
+    return pos;
+}
+
+// 判断offset处是否为函数之间的填充(nop、int3)，用于区分函数内的跳转和尾调用
+inline bool isPaddingBefore(const uint8_t *code,size_t offset){
+    if(offset==0) return false;
+    uint8_t b=code[offset-1];
+    return b==0x90 || b==0xcc || b==0x00;
+}
+// 判断offset处是否为填充到16字节对齐的nop，gcc在函数末尾的noreturn调用之后不再生成指令
+inline bool isNoreturnPadding(const uint8_t *code,size_t offset,size_t maxsize){
+    if(((size_t)(code+offset)&15)==0) return false; // 没有填充，无法判断
+    X86Instruction ins;
+    for(size_t pos=offset;pos<maxsize;pos+=ins.length){
+        if(((size_t)(code+pos)&15)==0) return true;
+        if(code[pos]==0x90 || code[pos]==0xcc){ins.length=1;continue;}
+        if(decodeX86(code+pos,maxsize-pos,&ins)==0) return false;
+        if(!(ins.opcode_map==1 && ins.opcode==0x1f)) return false; // 多字节nop
+    }
+    return false;
+}
+
+// 从入口开始沿所有分支解码，返回函数机器码的实际大小，无法解码时返回0
+inline size_t findFunctionExtent(const void *funcptr,size_t maxsize){
+    const uint8_t *code=(const uint8_t *)funcptr;
+    std::vector<size_t> worklist{0};
+    std::unordered_set<size_t> visited;
+    size_t extent=0;
+    X86Instruction ins;
+    while(!worklist.empty()){
+        size_t offset=worklist.back();worklist.pop_back();
+        while(offset<maxsize && visited.insert(offset).second){
+            if(decodeX86(code+offset,maxsize-offset,&ins)==0){
+                if(offset==0) return 0;
+                break;
+            }
+            size_t next=offset+ins.length;
+            if(next>extent) extent=next;
+            long long target=(long long)offset+ins.target;
+            if(ins.flow==FLOW_JCC){
+                if(target>=0 && (size_t)target<maxsize) worklist.push_back(target);
+            } else if(ins.flow==FLOW_JMP){
+                // 以rel32跳转到填充之后、对齐的地址时，视为跳转到其他函数的尾调用
+                if(target>=0 && (size_t)target<maxsize &&
+                   !(ins.opcode==0xe9 && (size_t)target>next && ((size_t)(code+target)&15)==0 &&
+                     (size_t)target>extent && isPaddingBefore(code,target)))
+                    worklist.push_back(target);
+                break;
+            } else if(ins.flow==FLOW_RET || ins.flow==FLOW_STOP ||
+                      ins.flow==FLOW_JMP_INDIRECT)
+                break;
+            else if(ins.flow==FLOW_CALL && isNoreturnPadding(code,next,maxsize))
+                break;
+            offset=next;
+        }
+    }
+    return extent;
+}